@@ -0,0 +1,345 @@
+#include "quantum.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "bench.hpp"
+#include "circuit.hpp"
+#include "feistel.hpp"
+#include "matrix.hpp"
+#include "native.hpp"
+#include "oracle.hpp"
+#include "permutation.hpp"
+#include "qmdd.hpp"
+#include "random.hpp"
+#include "sampler.hpp"
+#include "shard.hpp"
+#include "simon.hpp"
+#include "sparse.hpp"
+#include "table.hpp"
+#include "toffoli.hpp"
+#include "trials.hpp"
+
+//Seed of all random inputs of the benchmarks, fixed so every run measures the same work
+const uint64_t BENCH_SEED = 1;
+
+//3-round feistel network of the benchmarks, the same construction as the trials use
+template <size_t Bits>
+auto bench_feistel_function() {
+    std::shared_ptr<size_t[]> sbox(make_feistel_sbox(Bits, BENCH_SEED).release());
+    std::vector<size_t> keys = {1, 2, 3};
+    auto round_function = [=](size_t input, size_t key) {
+        return sbox[input ^ key];
+    };
+    return make_feistel_encrypt<Bits>(round_function, keys);
+}
+
+//Toffoli gates with all 2^N control masks selected at run time, one call applies every mask once
+template <size_t N>
+void bench_toffoli(BenchSuite& suite) {
+    std::string size = "/N=" + std::to_string(N);
+
+    if(suite.selects({"toffoli/runtime/native" + size})) {
+        NativeRegister native(N + 1);
+        suite.run("toffoli/runtime/native" + size, 1ull << N, [&] {
+            for(size_t mask = 0; mask < (1ull << N); ++mask)
+                create_masked_toffoli_runtime<N>(mask, &native, N, 0);
+            bench_keep(native);
+        });
+    }
+
+    if(suite.selects({"toffoli/runtime/libquantum" + size})) {
+        quantum_reg reg = quantum_new_qureg(0, N + 1);
+        for(size_t i = 0; i < N; ++i)
+            quantum_hadamard(i, &reg);
+        suite.run("toffoli/runtime/libquantum" + size, 1ull << N, [&] {
+            for(size_t mask = 0; mask < (1ull << N); ++mask)
+                create_masked_toffoli_runtime<N>(mask, &reg, N, 0);
+            bench_keep(reg);
+        });
+        quantum_delete_qureg(&reg);
+    }
+}
+
+//Application of the bitflip oracle of the f function of a feistel detection, on a fresh register
+template <size_t Bits>
+void bench_oracle(BenchSuite& suite) {
+    std::string size = "/bits=" + std::to_string(Bits);
+    auto feistel = bench_feistel_function<Bits>();
+    auto function = [=](size_t input) {
+        return run_f<Bits>(input, feistel, 1, 2);
+    };
+    auto oracle = bind_to_bitflip_oracle<Bits + 1, Bits>(function);
+
+    suite.run("oracle/native" + size, 1, [&] {
+        NativeRegister reg(2 * Bits + 1);
+        oracle(&reg);
+        bench_keep(reg);
+    });
+    suite.run("oracle/libquantum" + size, 1, [&] {
+        quantum_reg reg = quantum_new_qureg(0, 2 * Bits + 1);
+        oracle(&reg);
+        quantum_delete_qureg(&reg);
+    });
+}
+
+//Replay of the recorded bitflip oracle on the native register, as recorded, scheduled into layers, and optimised and scheduled
+template <size_t Bits>
+void bench_circuit(BenchSuite& suite) {
+    std::string size = "/bits=" + std::to_string(Bits);
+    if(!suite.selects({"circuit/native/recorded" + size, "circuit/native/scheduled" + size, "circuit/native/optimised" + size}))
+        return;
+    auto feistel = bench_feistel_function<Bits>();
+    auto function = [=](size_t input) {
+        return run_f<Bits>(input, feistel, 1, 2);
+    };
+    CircuitRecorder recorder(2 * Bits + 1);
+    bind_to_bitflip_oracle<Bits + 1, Bits>(function)(&recorder);
+    const Circuit& recorded = recorder.getCircuit();
+    Circuit scheduled = schedule_circuit(recorded);
+    Circuit optimised = schedule_circuit(optimize_circuit(recorded));
+
+    NativeRegister reg(2 * Bits + 1);
+    suite.run("circuit/native/recorded" + size, recorded.gates.size(), [&] {
+        replay_circuit(recorded, &reg);
+        bench_keep(reg);
+    });
+    suite.run("circuit/native/scheduled" + size, recorded.gates.size(), [&] {
+        replay_circuit(scheduled, &reg);
+        bench_keep(reg);
+    });
+    suite.run("circuit/native/optimised" + size, recorded.gates.size(), [&] {
+        replay_circuit(optimised, &reg);
+        bench_keep(reg);
+    });
+}
+
+//Replay of a circuit of Hadamard layers and X gates with few controls on a register wider than the tiles, gate by gate and tile by tile
+template <size_t Qubits>
+void bench_tiling(BenchSuite& suite) {
+    std::string size = "/qubits=" + std::to_string(Qubits);
+    if(!suite.selects({"tiling/native/per-gate" + size, "tiling/native/tiled" + size}))
+        return;
+    Circuit circuit = {Qubits, {}};
+    const uint64_t all = (1ull << Qubits) - 1;
+    circuit.gates.push_back({GateKind::HadamardLayer, 0, all, 0});
+    for(size_t i = 0; i < 64; ++i) {
+        uint64_t control = i % 2 == 0 ? 0 : 1ull << ((3 * i + 1) % Qubits);
+        uint32_t target = (7 * i) % Qubits;
+        if(control != 1ull << target)
+            circuit.gates.push_back({GateKind::X, target, control, 0});
+    }
+    circuit.gates.push_back({GateKind::HadamardLayer, 0, all, 0});
+
+    NativeRegister reg(Qubits);
+    suite.run("tiling/native/per-gate" + size, circuit.gates.size(), [&] {
+        for(const Gate& gate : circuit.gates)
+            apply_gate(&reg, gate);
+        bench_keep(reg);
+    });
+    suite.run("tiling/native/tiled" + size, circuit.gates.size(), [&] {
+        replay_circuit(circuit, &reg);
+        bench_keep(reg);
+    });
+}
+
+//A single run of Simon's algorithm on the f function of a feistel detection, per backend
+template <size_t Bits>
+void bench_simon(BenchSuite& suite) {
+    std::string size = "/bits=" + std::to_string(Bits);
+    auto feistel = bench_feistel_function<Bits>();
+    auto function = [=](size_t input) {
+        return run_f<Bits>(input, feistel, 1, 2);
+    };
+    auto oracle = bind_to_bitflip_oracle<Bits + 1, Bits>(function);
+    RandomStream rng(BENCH_SEED, 0, RandomStreamId::Measurement);
+
+    suite.run("simon/native" + size, 1, [&] {
+        bench_keep(run_simon<Bits + 1, Bits, NativeRegister>(oracle, rng));
+    });
+    suite.run("simon/native32" + size, 1, [&] {
+        bench_keep(run_simon<Bits + 1, Bits, NativeRegister32>(oracle, rng));
+    });
+    suite.run("simon/native-real" + size, 1, [&] {
+        bench_keep(run_simon<Bits + 1, Bits, RealNativeRegister>(oracle, rng));
+    });
+    suite.run("simon/native32-real" + size, 1, [&] {
+        bench_keep(run_simon<Bits + 1, Bits, RealNativeRegister32>(oracle, rng));
+    });
+    suite.run("simon/sparse" + size, 1, [&] {
+        bench_keep(run_simon<Bits + 1, Bits, RealSparseRegister>(oracle, rng));
+    });
+    suite.run("simon/qmdd" + size, 1, [&] {
+        bench_keep(run_simon<Bits + 1, Bits, RealQmddRegister>(oracle, rng));
+    });
+    suite.run("simon/sharded" + size, 1, [&] {
+        bench_keep(run_simon<Bits + 1, Bits, RealShardedRegister>(oracle, rng));
+    });
+    suite.run("simon/libquantum" + size, 1, [&] {
+        bench_keep(run_simon<Bits + 1, Bits>(oracle, rng));
+    });
+
+    if(suite.selects({"simon/sampler" + size})) {
+        SimonSampler<Bits + 1, Bits> sampler(function);
+        suite.run("simon/sampler" + size, 1, [&] {
+            bench_keep(sampler.sample(rng));
+        });
+    }
+    suite.run("simon/sampler-setup" + size, 1, [&] {
+        SimonSampler<Bits + 1, Bits> fresh(function);
+        bench_keep(fresh);
+    });
+}
+
+//A full feistel detection with the structured oracle over S-boxes of 2 bits, on the dense and the decision diagram backend
+//The register of the structured oracle is 3 * Bits + 1 qubits wide, so the dense backend is only run while it fits in 2^20 amplitudes
+template <size_t Bits>
+void bench_detection(BenchSuite& suite) {
+    std::string size = "/bits=" + std::to_string(Bits);
+    const size_t sbox_width = 2;
+    std::shared_ptr<size_t[]> sbox(make_feistel_sbox(sbox_width, BENCH_SEED).release());
+    std::vector<size_t> keys = {1, 2, 3};
+    auto feistel = make_feistel_encrypt<Bits>(SpnRoundFunction<Bits>{sbox.get(), sbox_width}, keys);
+    FeistelOracleFactory<Bits> make_oracle = {sbox.get(), sbox_width, keys};
+    TrialSeed trial = {BENCH_SEED, 0};
+
+    if(3 * Bits + 1 <= 20) {
+        suite.run("detection/native" + size, 1, [&] {
+            bench_keep(run_feistel_detect<Bits>(feistel, make_oracle, trial, Backend::Native).s);
+        });
+    }
+    suite.run("detection/qmdd" + size, 1, [&] {
+        bench_keep(run_feistel_detect<Bits>(feistel, make_oracle, trial, Backend::Qmdd).s);
+    });
+}
+
+//Adding rows to the equation solver until it holds Width independent rows, and solving the resulting system
+template <size_t Width>
+void bench_matrix(BenchSuite& suite) {
+    std::string size = "/width=" + std::to_string(Width);
+
+    //Rows orthogonal to a fixed solution, in masked encoding, as measured by Simon's algorithm on a 2-to-1 function
+    const size_t solution = 0x5a5a5a5a5a5a5a5aull & ((1ull << Width) - 1);
+    RandomStream rng(BENCH_SEED, 0, RandomStreamId::Parameters);
+    std::vector<size_t> rows;
+    MatrixSolver<Width> filled;
+    while(filled.getIndependent() < Width) {
+        size_t row = rng.uniform(1ull << Width);
+        rows.push_back(row << 1 | __builtin_parityll(row & solution));
+        filled.addRow(rows.back());
+    }
+
+    suite.run("matrix/addrow" + size, rows.size(), [&] {
+        MatrixSolver<Width> solver;
+        for(size_t row : rows)
+            solver.addRow(row);
+        bench_keep(solver);
+    });
+    suite.run("matrix/solve" + size, 1, [&] {
+        MatrixSolver<Width> solver = filled;
+        bench_keep(solver.solveEncoded());
+    });
+}
+
+//Feistel encryption of single blocks, and tabulation of the full codebook into memory and into a table file
+template <size_t Bits>
+void bench_feistel(BenchSuite& suite) {
+    std::string size = "/bits=" + std::to_string(Bits);
+    auto feistel = bench_feistel_function<Bits>();
+    const size_t count = 1ull << (2 * Bits);
+
+    size_t input = 0;
+    suite.run("feistel/encrypt" + size, 1024, [&] {
+        for(size_t i = 0; i < 1024; ++i)
+            input = feistel(input + i) & (count - 1);
+        bench_keep(input);
+    });
+
+    if(suite.selects({"feistel/tabulate" + size})) {
+        std::vector<uint32_t> codebook(count);
+        suite.run("feistel/tabulate" + size, count, [&] {
+            for(size_t i = 0; i < count; ++i)
+                codebook[i] = feistel(i);
+            bench_keep(codebook.data());
+        });
+    }
+
+    std::string path = std::string(P_tmpdir) + "/qa_bench_" + std::to_string(getpid()) + ".qat";
+    TableHeader header = make_table_header(TableCipher::Feistel, Bits, 3, Bits, BENCH_SEED, 0, 2 * Bits, count);
+    suite.run("feistel/write-table" + size, count, [&] {
+        write_table(path, header, feistel);
+    });
+    unlink(path.c_str());
+}
+
+//Generation of the S-box permutation map used by the feistel round function
+void bench_permutation(BenchSuite& suite) {
+    for(size_t bits : {8, 16}) {
+        RandomStream rng(BENCH_SEED, 0, RandomStreamId::Cipher);
+        suite.run("permutation/generate-map/bits=" + std::to_string(bits), 100000, [&] {
+            size_t* map = generate_permuation_map(1ull << bits, 100000, rng);
+            bench_keep(map[0]);
+            delete[] map;
+        });
+    }
+}
+
+//Usage: qa_bench [-f filter] [-w warmup repetitions] [-r repetitions] [-t target seconds per repetition]
+//Writes one JSON object per benchmark case to stdout, and a human-readable line per case to stderr
+int main(int argc, char** argv) {
+    std::string filter;
+    size_t warmup = 2;
+    size_t repetitions = 100;
+    double target_seconds = 0.001;
+
+    int option;
+    while((option = getopt(argc, argv, "f:w:r:t:")) != -1) {
+        switch(option) {
+            case 'f':
+                filter = optarg;
+                break;
+            case 'w':
+                warmup = std::stoull(optarg);
+                break;
+            case 'r':
+                repetitions = std::stoull(optarg);
+                break;
+            case 't':
+                target_seconds = std::stod(optarg);
+                break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-f filter] [-w warmup repetitions] [-r repetitions] [-t target seconds per repetition]" << std::endl;
+                return 1;
+        }
+    }
+
+    BenchSuite suite(filter, warmup, repetitions, target_seconds);
+
+    bench_toffoli<4>(suite);
+    bench_toffoli<8>(suite);
+    bench_toffoli<12>(suite);
+    bench_oracle<3>(suite);
+    bench_oracle<5>(suite);
+    bench_circuit<5>(suite);
+    bench_circuit<7>(suite);
+    bench_tiling<16>(suite);
+    bench_tiling<24>(suite);
+    bench_simon<3>(suite);
+    bench_simon<5>(suite);
+    bench_detection<4>(suite);
+    bench_detection<6>(suite);
+    bench_detection<8>(suite);
+    bench_matrix<8>(suite);
+    bench_matrix<16>(suite);
+    bench_feistel<4>(suite);
+    bench_feistel<8>(suite);
+    bench_permutation(suite);
+
+    print_bench_results(std::cout, suite.getResults());
+    return 0;
+}
@@ -0,0 +1,124 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_BENCH
+#define QUANTUM_CRYPTO_ATTACK_BENCH
+
+//Minimal microbenchmark harness
+//Every case is calibrated so a repetition takes at least the target time, warmed up, and then timed over a number of repetitions.
+//Results are reported as one JSON object per line, so runs can be stored and compared over time
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//Prevents the compiler from optimizing away the computation of value
+template <typename T>
+inline void bench_keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+//Timing statistics of a single benchmark case
+struct BenchResult {
+    std::string name;
+    //Number of timed repetitions, calls of the case per repetition, and operations per call
+    size_t repetitions;
+    size_t iterations;
+    size_t operations;
+    //Statistics of the time per call in seconds, p99 is the nearest-rank 99th percentile and max the slowest repetition
+    double median;
+    double p99;
+    double max;
+    double mean;
+    double min;
+
+    //Operations per second, based on the median time per call
+    inline double operationsPerSecond() const {
+        return this->median > 0 ? this->operations / this->median : 0;
+    }
+};
+
+//Runs benchmark cases and collects their results
+class BenchSuite {
+    private:
+        //Only cases whose name contains the filter are run
+        std::string filter;
+        size_t warmup;
+        size_t repetitions;
+        //Minimal wall time of a single repetition, calls are batched until a repetition takes at least this long
+        double target_seconds;
+        std::vector<BenchResult> results;
+
+        template <typename Func>
+        static double time_calls(Func& function, size_t iterations) {
+            auto start = std::chrono::steady_clock::now();
+            for(size_t i = 0; i < iterations; ++i)
+                function();
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    public:
+        BenchSuite(const std::string& filter, size_t warmup, size_t repetitions, double target_seconds)
+            : filter(filter), warmup(warmup), repetitions(std::max<size_t>(repetitions, 1)), target_seconds(target_seconds) {}
+
+        //Checks whether any of the named cases passes the filter, so fixtures only set up the state of cases that are run
+        bool selects(std::initializer_list<std::string> names) const {
+            return std::any_of(names.begin(), names.end(), [&](const std::string& name) {
+                return name.find(this->filter) != std::string::npos;
+            });
+        }
+
+        //Benchmarks function, a call of which performs the given number of operations
+        template <typename Func>
+        void run(const std::string& name, size_t operations, Func function) {
+            if(!this->selects({name}))
+                return;
+
+            //Calibrate the number of calls per repetition, doubling until a repetition takes at least the target time
+            size_t iterations = 1;
+            while(time_calls(function, iterations) < this->target_seconds && iterations < (1ull << 30))
+                iterations <<= 1;
+
+            for(size_t i = 0; i < this->warmup; ++i)
+                time_calls(function, iterations);
+
+            std::vector<double> samples(this->repetitions);
+            for(double& sample : samples)
+                sample = time_calls(function, iterations) / iterations;
+            std::sort(samples.begin(), samples.end());
+
+            BenchResult result;
+            result.name = name;
+            result.repetitions = this->repetitions;
+            result.iterations = iterations;
+            result.operations = operations;
+            result.median = samples[samples.size() / 2];
+            result.p99 = samples[(samples.size() * 99 + 99) / 100 - 1];
+            result.max = samples.back();
+            result.min = samples.front();
+            result.mean = 0;
+            for(double sample : samples)
+                result.mean += sample / samples.size();
+            this->results.push_back(result);
+
+            std::fprintf(stderr, "%-48s median %12.3fus  p99 %12.3fus  max %12.3fus  %14.1f ops/s\n", name.c_str(), result.median * 1e6, result.p99 * 1e6, result.max * 1e6, result.operationsPerSecond());
+        }
+
+        inline const std::vector<BenchResult>& getResults() const {
+            return this->results;
+        }
+};
+
+//Writes the results as one JSON object per line
+inline void print_bench_results(std::ostream& out, const std::vector<BenchResult>& results) {
+    for(const BenchResult& result : results) {
+        char line[512];
+        std::snprintf(line, sizeof(line),
+            "{\"name\":\"%s\",\"repetitions\":%zu,\"iterations\":%zu,\"operations\":%zu,\"median\":%.9g,\"p99\":%.9g,\"max\":%.9g,\"mean\":%.9g,\"min\":%.9g,\"ops_per_second\":%.9g}",
+            result.name.c_str(), result.repetitions, result.iterations, result.operations, result.median, result.p99, result.max, result.mean, result.min,
+            result.operationsPerSecond());
+        out << line << std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_CHECKPOINT
+#define QUANTUM_CRYPTO_ATTACK_CHECKPOINT
+
+//Checkpoints of long experiment runs
+//A checkpoint holds the record of every finished trial, so a restarted run skips those trials and rebuilds its summaries from the records.
+//Trials draw all random values from their own streams starting at position 0, so unfinished trials simply rerun from the start,
+//and the records of finished trials are the only state a run has to persist
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sink.hpp"
+
+//Version of the checkpoint file layout, has to be incremented whenever the header or TrialRecord changes
+constexpr uint32_t CHECKPOINT_VERSION = 1;
+constexpr char CHECKPOINT_MAGIC[8] = {'Q', 'A', 'C', 'K', 'P', 'T', '\0', '\0'};
+
+//Header at the start of every checkpoint file, the records directly follow the header
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    //Identifies the experiment the checkpoint belongs to, see Checkpoint
+    uint64_t fingerprint;
+    uint64_t count;
+};
+
+//Set of finished trial records, keyed by sequence number, which is saved to a file periodically
+//Safe to use from multiple threads
+class Checkpoint {
+    private:
+        std::string path;
+        uint64_t fingerprint;
+        std::chrono::duration<double> save_interval;
+        std::chrono::steady_clock::time_point last_save;
+        std::mutex mutex;
+        std::map<uint64_t, TrialRecord> records;
+        //Whether records were added since the last save
+        bool dirty;
+
+        //Writes all records to a temporary file and renames it into place, so a crash never leaves a partial checkpoint
+        void saveLocked() {
+            std::string temporary_path = this->path + ".tmp." + std::to_string(getpid());
+            int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if(fd < 0)
+                throw std::runtime_error("Could not create checkpoint file " + temporary_path);
+
+            CheckpointHeader header;
+            std::memset(&header, 0, sizeof(header));
+            std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+            header.version = CHECKPOINT_VERSION;
+            header.record_size = sizeof(TrialRecord);
+            header.fingerprint = this->fingerprint;
+            header.count = this->records.size();
+
+            std::string buffer(reinterpret_cast<const char*>(&header), sizeof(header));
+            for(const auto& entry : this->records)
+                buffer.append(reinterpret_cast<const char*>(&entry.second), sizeof(TrialRecord));
+
+            size_t written = 0;
+            while(written < buffer.size()) {
+                ssize_t result = write(fd, buffer.data() + written, buffer.size() - written);
+                if(result < 0)
+                    break;
+                written += result;
+            }
+            bool synced = written == buffer.size() && fsync(fd) == 0;
+            close(fd);
+            if(!synced || rename(temporary_path.c_str(), this->path.c_str()) != 0) {
+                unlink(temporary_path.c_str());
+                throw std::runtime_error("Could not write checkpoint file " + this->path);
+            }
+            this->dirty = false;
+            this->last_save = std::chrono::steady_clock::now();
+        }
+
+        //Loads the records of an existing checkpoint file, a missing file is an empty checkpoint
+        void load() {
+            int fd = open(this->path.c_str(), O_RDONLY);
+            if(fd < 0)
+                return;
+
+            std::string contents;
+            char chunk[1 << 16];
+            ssize_t result;
+            while((result = read(fd, chunk, sizeof(chunk))) > 0)
+                contents.append(chunk, result);
+            close(fd);
+
+            CheckpointHeader header;
+            if(result < 0 || contents.size() < sizeof(header))
+                throw std::runtime_error("Invalid checkpoint file " + this->path);
+            std::memcpy(&header, contents.data(), sizeof(header));
+            if(std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 || header.version != CHECKPOINT_VERSION
+                || header.record_size != sizeof(TrialRecord) || contents.size() != sizeof(header) + header.count * sizeof(TrialRecord))
+                throw std::runtime_error("Invalid checkpoint file " + this->path);
+            if(header.fingerprint != this->fingerprint)
+                throw std::runtime_error("Checkpoint file " + this->path + " belongs to an experiment with other options");
+
+            for(size_t i = 0; i < header.count; ++i) {
+                TrialRecord record;
+                std::memcpy(&record, contents.data() + sizeof(header) + i * sizeof(TrialRecord), sizeof(TrialRecord));
+                this->records.emplace(record.sequence, record);
+            }
+        }
+    public:
+        //Opens the checkpoint at path, loading the records it already holds
+        //The fingerprint has to identify every option that influences which trial a sequence number refers to, or its result.
+        //Opening a checkpoint with another fingerprint throws, so a run never resumes from an unrelated experiment
+        Checkpoint(const std::string& path, uint64_t fingerprint, double save_seconds = 30)
+            : path(path), fingerprint(fingerprint), save_interval(save_seconds), last_save(std::chrono::steady_clock::now()), dirty(false) {
+            this->load();
+        }
+
+        Checkpoint(const Checkpoint&) = delete;
+        Checkpoint& operator=(const Checkpoint&) = delete;
+
+        //Number of finished trials in the checkpoint
+        size_t size() {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            return this->records.size();
+        }
+
+        //Looks up the record with the given sequence number, returns false when that trial has not finished yet
+        bool find(uint64_t sequence, TrialRecord& record) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            auto found = this->records.find(sequence);
+            if(found == this->records.end())
+                return false;
+            record = found->second;
+            return true;
+        }
+
+        //Adds the record of a finished trial, and saves the checkpoint when the save interval has passed
+        void add(const TrialRecord& record) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->dirty |= this->records.emplace(record.sequence, record).second;
+            if(this->dirty && std::chrono::steady_clock::now() - this->last_save >= this->save_interval)
+                this->saveLocked();
+        }
+
+        //Saves the checkpoint if records were added since the last save
+        void save() {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if(this->dirty)
+                this->saveLocked();
+        }
+};
+
+//Incrementally builds a checkpoint fingerprint, FNV-1a over the added values
+class CheckpointFingerprint {
+    private:
+        uint64_t hash;
+    public:
+        CheckpointFingerprint() : hash(0xcbf29ce484222325ull) {}
+
+        CheckpointFingerprint& add(uint64_t value) {
+            for(size_t i = 0; i < 8; ++i)
+                this->hash = (this->hash ^ ((value >> (8 * i)) & 0xff)) * 0x100000001b3ull;
+            return *this;
+        }
+
+        inline uint64_t get() const {
+            return this->hash;
+        }
+};
+
+#endif
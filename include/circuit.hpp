@@ -0,0 +1,647 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_CIRCUIT
+#define QUANTUM_CRYPTO_ATTACK_CIRCUIT
+
+//Circuit IR, a flat vector of plain gate records
+//CircuitRecorder implements the register interface of register.hpp, so every circuit construction helper, oracle and run_simon_circuit
+//records into a circuit unchanged. optimize_circuit runs peephole passes over a recorded circuit, and replay_circuit applies it to any register type.
+//CachedOracle records an oracle once, optimises it, and replays the optimised circuit for every query
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "instrument.hpp"
+#include "native.hpp"
+#include "qmdd.hpp"
+#include "register.hpp"
+#include "shard.hpp"
+#include "simon.hpp"
+#include "sparse.hpp"
+#include "toffoli.hpp"
+#include "trace.hpp"
+
+//Largest number of qubits of a circuit, qubits are stored as bits of a 64-bit mask
+constexpr size_t CIRCUIT_MAX_QUBITS = 64;
+
+enum class GateKind : uint8_t {
+    //Hadamard gate on every qubit in mask
+    HadamardLayer,
+    //Toggles target in the basis states where all qubits in mask are 1 and all qubits in negated are 0, a plain X gate has no controls
+    X
+};
+
+//Whether the gates of a kind have real matrices, see oracle_is_real
+inline bool gate_kind_is_real(GateKind kind) {
+    switch(kind) {
+        case GateKind::HadamardLayer:
+        case GateKind::X:
+            return true;
+    }
+    return false;
+}
+
+//A single gate of a circuit
+struct Gate {
+    GateKind kind;
+    uint32_t target;
+    uint64_t mask;
+    uint64_t negated;
+
+    inline bool operator==(const Gate& other) const {
+        return this->kind == other.kind && this->target == other.target && this->mask == other.mask && this->negated == other.negated;
+    }
+
+    //Number of controls of an X gate
+    inline size_t controls() const {
+        return __builtin_popcountll(this->mask | this->negated);
+    }
+};
+
+struct Circuit {
+    size_t width;
+    std::vector<Gate> gates;
+    //Index of the first gate of every layer, in a circuit ordered by schedule_circuit, otherwise empty
+    //Only used to report the depth of a circuit, replays apply the gates in order and TiledReplay batches across layer boundaries
+    std::vector<size_t> layers = {};
+};
+
+inline bool circuit_is_real(const Circuit& circuit) {
+    return std::all_of(circuit.gates.begin(), circuit.gates.end(), [](const Gate& gate) {
+        return gate_kind_is_real(gate.kind);
+    });
+}
+
+//Applies a circuit of X gates to a single basis state, such circuits are classical reversible circuits
+inline uint64_t evaluate_basis_state(const Circuit& circuit, uint64_t state) {
+    for(const Gate& gate : circuit.gates) {
+        if(gate.kind != GateKind::X)
+            throw std::runtime_error("Only circuits of X gates can be evaluated on basis states");
+        if((state & (gate.mask | gate.negated)) == gate.mask)
+            state ^= 1ull << gate.target;
+    }
+    return state;
+}
+
+//Register recording every gate applied to it into a circuit
+class CircuitRecorder {
+    private:
+        Circuit circuit;
+
+        inline void check(size_t qubit) const {
+            if(qubit >= this->circuit.width)
+                throw std::runtime_error("Qubit " + std::to_string(qubit) + " outside of a circuit of " + std::to_string(this->circuit.width) + " qubits");
+        }
+    public:
+        explicit CircuitRecorder(size_t width) {
+            if(width > CIRCUIT_MAX_QUBITS)
+                throw std::runtime_error("Circuits are limited to " + std::to_string(CIRCUIT_MAX_QUBITS) + " qubits, got " + std::to_string(width));
+            this->circuit.width = width;
+        }
+
+        void hadamard(size_t target) {
+            this->check(target);
+            this->circuit.gates.push_back({GateKind::HadamardLayer, 0, 1ull << target, 0});
+        }
+
+        void sigmaX(size_t target) {
+            this->check(target);
+            this->circuit.gates.push_back({GateKind::X, uint32_t(target), 0, 0});
+        }
+
+        void toffoli(const size_t* controls, size_t count, size_t target) {
+            this->check(target);
+            uint64_t mask = 0;
+            for(size_t i = 0; i < count; ++i) {
+                this->check(controls[i]);
+                mask |= 1ull << controls[i];
+            }
+            this->circuit.gates.push_back({GateKind::X, uint32_t(target), mask, 0});
+        }
+
+        inline size_t getWidth() const {
+            return this->circuit.width;
+        }
+
+        inline const Circuit& getCircuit() const {
+            return this->circuit;
+        }
+
+        inline Circuit takeCircuit() {
+            return std::move(this->circuit);
+        }
+};
+
+//Peephole pass absorbing plain X gates into the polarity of the controls of the gates following them
+//An X on a control qubit flips the polarity of that control, and commutes with X gates targeting the same qubit, so X gates are delayed
+//until a Hadamard layer or the end of the circuit. Pairs of X gates on the same qubit cancel on the way, so the conjugating X gates of
+//create_toggle_if_match turn into negated controls and vanish
+inline Circuit absorb_x_gates(const Circuit& circuit) {
+    Circuit result = {circuit.width, {}};
+    result.gates.reserve(circuit.gates.size());
+    //Qubits with an odd number of delayed X gates
+    uint64_t pending = 0;
+    auto flush = [&](uint64_t qubits) {
+        for(uint64_t remaining = qubits & pending; remaining != 0; remaining &= remaining - 1)
+            result.gates.push_back({GateKind::X, uint32_t(__builtin_ctzll(remaining)), 0, 0});
+        pending &= ~qubits;
+    };
+
+    for(Gate gate : circuit.gates) {
+        if(gate.kind == GateKind::HadamardLayer) {
+            flush(gate.mask);
+            result.gates.push_back(gate);
+        }
+        else if(gate.controls() == 0) {
+            pending ^= 1ull << gate.target;
+        }
+        else {
+            uint64_t flipped = pending & (gate.mask | gate.negated);
+            gate.mask ^= flipped;
+            gate.negated ^= flipped;
+            result.gates.push_back(gate);
+        }
+    }
+    flush(~0ull);
+    return result;
+}
+
+//Toggles of a single target, as the set of the controls (all controls, positive controls) of its X gates
+//X gates with the same controls cancel in pairs, so a set holds the parity of every combination
+using ToggleSet = std::set<std::pair<uint64_t, uint64_t>>;
+
+inline void toggle(ToggleSet& toggles, const std::pair<uint64_t, uint64_t>& key) {
+    if(!toggles.erase(key))
+        toggles.insert(key);
+}
+
+//Merges pairs of toggles differing only in the polarity of one control into a single toggle without that control, until none are left
+inline void merge_toggles(ToggleSet& toggles) {
+    bool merged = true;
+    while(merged) {
+        merged = false;
+        for(auto it = toggles.begin(); it != toggles.end();) {
+            const uint64_t controls = it->first;
+            const uint64_t positive = it->second;
+            auto partner = toggles.end();
+            uint64_t bit = 0;
+            for(uint64_t remaining = controls; remaining != 0 && partner == toggles.end(); remaining &= remaining - 1) {
+                bit = remaining & -remaining;
+                partner = toggles.find({controls, positive ^ bit});
+            }
+            if(partner == toggles.end()) {
+                ++it;
+                continue;
+            }
+            toggles.erase(partner);
+            it = toggles.erase(it);
+            toggle(toggles, {controls & ~bit, positive & ~bit});
+            merged = true;
+        }
+    }
+}
+
+//Peephole pass merging the controlled X gates within blocks of commuting gates
+//X gates commute when neither targets a control of the other, so within a block only the parity of the toggles of every target matters:
+//equal gates cancel, and gates differing in the polarity of a single control merge, which shrinks truth table oracles considerably
+inline Circuit merge_commuting_gates(const Circuit& circuit) {
+    Circuit result = {circuit.width, {}};
+    result.gates.reserve(circuit.gates.size());
+    std::map<uint32_t, ToggleSet> block;
+    uint64_t block_controls = 0;
+    uint64_t block_targets = 0;
+    auto flush = [&]() {
+        for(auto& [target, toggles] : block) {
+            merge_toggles(toggles);
+            for(const std::pair<uint64_t, uint64_t>& key : toggles)
+                result.gates.push_back({GateKind::X, target, key.second, key.first & ~key.second});
+        }
+        block.clear();
+        block_controls = 0;
+        block_targets = 0;
+    };
+
+    for(const Gate& gate : circuit.gates) {
+        if(gate.kind == GateKind::HadamardLayer) {
+            flush();
+            result.gates.push_back(gate);
+            continue;
+        }
+        const uint64_t controls = gate.mask | gate.negated;
+        const uint64_t target = 1ull << gate.target;
+        if((target & block_controls) != 0 || (controls & block_targets) != 0)
+            flush();
+        toggle(block[gate.target], {controls, gate.mask});
+        block_controls |= controls;
+        block_targets |= target;
+    }
+    flush();
+    return result;
+}
+
+//Peephole pass fusing adjacent Hadamard layers into a single layer, a qubit in both layers cancels
+inline Circuit fuse_hadamard_layers(const Circuit& circuit) {
+    Circuit result = {circuit.width, {}};
+    result.gates.reserve(circuit.gates.size());
+    for(const Gate& gate : circuit.gates) {
+        if(gate.kind == GateKind::HadamardLayer && !result.gates.empty() && result.gates.back().kind == GateKind::HadamardLayer) {
+            result.gates.back().mask ^= gate.mask;
+            if(result.gates.back().mask == 0)
+                result.gates.pop_back();
+        }
+        else {
+            result.gates.push_back(gate);
+        }
+    }
+    return result;
+}
+
+//Runs all peephole passes, the optimised circuit applies the same unitary
+inline Circuit optimize_circuit(const Circuit& circuit) {
+    QA_TRACE_SCOPE("circuit", "optimize", circuit.gates.size());
+    return fuse_hadamard_layers(merge_commuting_gates(absorb_x_gates(circuit)));
+}
+
+//Orders the gates of a circuit into layers of gates on disjoint qubits, every gate in the earliest layer after all earlier gates on its qubits
+//The depth of the circuit is its number of layers
+inline Circuit schedule_circuit(const Circuit& circuit) {
+    QA_TRACE_SCOPE("circuit", "schedule", circuit.gates.size());
+    //Layer of every gate, and the number of layers up to the last gate on every qubit
+    std::vector<size_t> layer_of(circuit.gates.size());
+    std::vector<size_t> qubit_layers(circuit.width, 0);
+    size_t depth = 0;
+    for(size_t i = 0; i < circuit.gates.size(); ++i) {
+        const Gate& gate = circuit.gates[i];
+        uint64_t qubits = gate.kind == GateKind::HadamardLayer ? gate.mask : gate.mask | gate.negated | (1ull << gate.target);
+        size_t layer = 0;
+        for(uint64_t remaining = qubits; remaining != 0; remaining &= remaining - 1)
+            layer = std::max(layer, qubit_layers[__builtin_ctzll(remaining)]);
+        for(uint64_t remaining = qubits; remaining != 0; remaining &= remaining - 1)
+            qubit_layers[__builtin_ctzll(remaining)] = layer + 1;
+        layer_of[i] = layer;
+        depth = std::max(depth, layer + 1);
+    }
+
+    //Counting sort of the gates by their layer, keeping the order of the gates within a layer
+    Circuit result = {circuit.width, std::vector<Gate>(circuit.gates.size()), std::vector<size_t>(depth + 1, 0)};
+    for(size_t layer : layer_of)
+        ++result.layers[layer + 1];
+    for(size_t layer = 1; layer <= depth; ++layer)
+        result.layers[layer] += result.layers[layer - 1];
+    std::vector<size_t> next(result.layers.begin(), result.layers.end() - 1);
+    for(size_t i = 0; i < circuit.gates.size(); ++i)
+        result.gates[next[layer_of[i]]++] = circuit.gates[i];
+    result.layers.pop_back();
+    return result;
+}
+
+//Applies a single gate through the register interface, negated controls are conjugated with X gates
+template <typename Reg>
+void apply_gate(Reg* reg, const Gate& gate) {
+    if(gate.kind == GateKind::HadamardLayer) {
+        for(uint64_t remaining = gate.mask; remaining != 0; remaining &= remaining - 1)
+            apply_hadamard(reg, __builtin_ctzll(remaining));
+        return;
+    }
+    if(gate.controls() == 0) {
+        apply_sigma_x(reg, gate.target);
+        return;
+    }
+
+    size_t controls[CIRCUIT_MAX_QUBITS];
+    size_t count = 0;
+    for(uint64_t remaining = gate.mask | gate.negated; remaining != 0; remaining &= remaining - 1)
+        controls[count++] = __builtin_ctzll(remaining);
+    for(uint64_t remaining = gate.negated; remaining != 0; remaining &= remaining - 1)
+        apply_sigma_x(reg, __builtin_ctzll(remaining));
+    create_nbit_toffoli_runtime<CIRCUIT_MAX_QUBITS>(reg, gate.target, controls, count);
+    for(uint64_t remaining = gate.negated; remaining != 0; remaining &= remaining - 1)
+        apply_sigma_x(reg, __builtin_ctzll(remaining));
+}
+
+//The native register applies negated controls directly, in a single sweep over the matching basis states
+template <typename Amplitude>
+void apply_gate(BasicNativeRegister<Amplitude>* reg, const Gate& gate) {
+    if(gate.kind == GateKind::X && gate.controls() != 0) {
+        QA_COUNT(ToffoliGates, 1);
+        reg->toffoliMask(gate.mask, gate.target, gate.negated);
+        return;
+    }
+    apply_gate<BasicNativeRegister<Amplitude>>(reg, gate);
+}
+
+//The sparse register applies negated controls directly as well
+template <typename Amplitude>
+void apply_gate(BasicSparseRegister<Amplitude>* reg, const Gate& gate) {
+    if(gate.kind == GateKind::X && gate.controls() != 0) {
+        QA_COUNT(ToffoliGates, 1);
+        reg->toffoliMask(gate.mask, gate.target, gate.negated);
+        return;
+    }
+    apply_gate<BasicSparseRegister<Amplitude>>(reg, gate);
+}
+
+template <typename Amplitude>
+void apply_gate(BasicQmddRegister<Amplitude>* reg, const Gate& gate) {
+    if(gate.kind == GateKind::X && gate.controls() != 0) {
+        QA_COUNT(ToffoliGates, 1);
+        reg->toffoliMask(gate.mask, gate.target, gate.negated);
+        return;
+    }
+    apply_gate<BasicQmddRegister<Amplitude>>(reg, gate);
+}
+
+template <typename Amplitude>
+void apply_gate(BasicShardedRegister<Amplitude>* reg, const Gate& gate) {
+    if(gate.kind == GateKind::X && gate.controls() != 0) {
+        QA_COUNT(ToffoliGates, 1);
+        reg->toffoliMask(gate.mask, gate.target, gate.negated);
+        return;
+    }
+    apply_gate<BasicShardedRegister<Amplitude>>(reg, gate);
+}
+
+//Applies every gate of a circuit to a register at least as wide as the circuit
+template <typename Reg>
+void replay_circuit(const Circuit& circuit, Reg* reg) {
+    for(const Gate& gate : circuit.gates)
+        apply_gate(reg, gate);
+}
+
+//Number of following gates TiledReplay looks at to decide whether a qubit above the tiles is moved into them
+constexpr size_t TILE_LOOKAHEAD = 1024;
+
+//Replays a circuit on the native register tile by tile, see NativeRegister::applyTiles
+//Gates on the qubits inside the tiles are collected and applied in a single sweep. The work of a qubit is the number of passes over the
+//state vector the gates on it within the lookahead would take when applied directly. A gate on a qubit above the tiles swaps that qubit
+//with the qubit inside the tiles with the least work, when its own work exceeds that by more than one pass, about the cost of swapping
+//it in and out again. Otherwise it is applied directly. The qubits are swapped back to their positions after the circuit
+template <typename Amplitude>
+class TiledReplay {
+    private:
+        BasicNativeRegister<Amplitude>* reg;
+        size_t tile_qubits;
+        //Position in the register of every qubit, and the qubit at every position
+        std::vector<size_t> position;
+        std::vector<size_t> qubit;
+        //Gate index plus one of the last gate acting on every position inside the tiles, the positions of the current gate are never evicted
+        std::vector<size_t> claimed;
+        std::vector<TileGate> pending;
+        //Per qubit, the indices of the gates acting on it, and the running sum of the fractions of the state vector these gates touch
+        std::vector<std::vector<size_t>> uses;
+        std::vector<std::vector<double>> weights;
+
+        //Fraction of the state vector a gate on one of its qubits touches when applied directly
+        static double gate_weight(const Gate& gate) {
+            return gate.kind == GateKind::HadamardLayer ? 1.0 : 1.0 / double(1ull << gate.controls());
+        }
+
+        void index(const Circuit& circuit) {
+            this->uses.assign(circuit.width, {});
+            this->weights.assign(circuit.width, {});
+            for(size_t i = 0; i < circuit.gates.size(); ++i) {
+                const Gate& gate = circuit.gates[i];
+                uint64_t targets = gate.kind == GateKind::HadamardLayer ? gate.mask : 1ull << gate.target;
+                for(uint64_t remaining = targets; remaining != 0; remaining &= remaining - 1) {
+                    size_t target = __builtin_ctzll(remaining);
+                    double total = this->weights[target].empty() ? 0 : this->weights[target].back();
+                    this->uses[target].push_back(i);
+                    this->weights[target].push_back(total + gate_weight(gate));
+                }
+            }
+        }
+
+        //Work of a qubit from gate index on
+        double work(size_t target, size_t index) const {
+            if(target >= this->uses.size())
+                return 0;
+            const std::vector<size_t>& uses = this->uses[target];
+            const std::vector<double>& weights = this->weights[target];
+            size_t first = std::lower_bound(uses.begin(), uses.end(), index) - uses.begin();
+            size_t last = std::lower_bound(uses.begin(), uses.end(), index + TILE_LOOKAHEAD) - uses.begin();
+            if(first == last)
+                return 0;
+            return weights[last - 1] - (first == 0 ? 0 : weights[first - 1]);
+        }
+
+        uint64_t positions(uint64_t qubits) const {
+            uint64_t result = 0;
+            for(uint64_t remaining = qubits; remaining != 0; remaining &= remaining - 1)
+                result |= 1ull << this->position[__builtin_ctzll(remaining)];
+            return result;
+        }
+
+        void flush() {
+            if(this->pending.empty())
+                return;
+            this->reg->applyTiles(this->pending.data(), this->pending.size());
+            this->pending.clear();
+        }
+
+        void swapPositions(size_t first, size_t second) {
+            this->flush();
+            this->reg->swapQubits(first, second);
+            std::swap(this->qubit[first], this->qubit[second]);
+            this->position[this->qubit[first]] = first;
+            this->position[this->qubit[second]] = second;
+        }
+
+        //Position of target inside the tiles after swapping it in if that is worth it, or its position above the tiles
+        size_t place(size_t target, size_t index) {
+            size_t current = this->position[target];
+            if(current >= this->tile_qubits) {
+                size_t victim = this->tile_qubits;
+                double victim_work = this->work(target, index) - 1.0;
+                for(size_t i = 0; i < this->tile_qubits; ++i) {
+                    if(this->claimed[i] == index + 1)
+                        continue;
+                    double candidate = this->work(this->qubit[i], index);
+                    if(candidate < victim_work) {
+                        victim = i;
+                        victim_work = candidate;
+                    }
+                }
+                if(victim < this->tile_qubits) {
+                    this->swapPositions(victim, current);
+                    current = victim;
+                }
+            }
+            if(current < this->tile_qubits)
+                this->claimed[current] = index + 1;
+            return current;
+        }
+
+        void applyHadamards(const Gate& gate, size_t index) {
+            //Claim the qubits of the layer already inside the tiles first, so placing the others does not evict them
+            for(uint64_t remaining = gate.mask; remaining != 0; remaining &= remaining - 1) {
+                size_t current = this->position[__builtin_ctzll(remaining)];
+                if(current < this->tile_qubits)
+                    this->claimed[current] = index + 1;
+            }
+            for(uint64_t remaining = gate.mask; remaining != 0; remaining &= remaining - 1) {
+                QA_COUNT(HadamardGates, 1);
+                size_t target = this->place(__builtin_ctzll(remaining), index);
+                if(target < this->tile_qubits) {
+                    this->pending.push_back({true, 0, 0, 1ull << target});
+                } else {
+                    this->flush();
+                    this->reg->hadamard(target);
+                }
+            }
+        }
+
+        void applyX(const Gate& gate, size_t index) {
+            if(gate.controls() == 0)
+                QA_COUNT(SigmaXGates, 1);
+            else
+                QA_COUNT(ToffoliGates, 1);
+            size_t target = this->place(gate.target, index);
+            uint64_t mask = this->positions(gate.mask);
+            uint64_t negated = this->positions(gate.negated);
+            if(target < this->tile_qubits) {
+                this->pending.push_back({false, mask | negated, mask, 1ull << target});
+                return;
+            }
+            this->flush();
+            if(gate.controls() == 0)
+                this->reg->sigmaX(target);
+            else
+                this->reg->toffoliMask(mask, target, negated);
+        }
+
+    public:
+        explicit TiledReplay(BasicNativeRegister<Amplitude>* reg) : reg(reg), tile_qubits(std::min(reg->getWidth(), NATIVE_TILE_QUBITS)) {
+            this->position.resize(reg->getWidth());
+            this->qubit.resize(reg->getWidth());
+            for(size_t i = 0; i < reg->getWidth(); ++i)
+                this->position[i] = this->qubit[i] = i;
+            this->claimed.assign(this->tile_qubits, 0);
+        }
+
+        void run(const Circuit& circuit) {
+            QA_TRACE_SCOPE("circuit", "tiled replay", circuit.gates.size());
+            this->index(circuit);
+            for(size_t i = 0; i < circuit.gates.size(); ++i) {
+                const Gate& gate = circuit.gates[i];
+                if(gate.kind == GateKind::HadamardLayer)
+                    this->applyHadamards(gate, i);
+                else
+                    this->applyX(gate, i);
+            }
+            this->flush();
+            //Undo the permutation of the qubits, every swap moves one qubit to its own position
+            for(size_t i = 0; i < this->qubit.size(); ++i)
+                while(this->qubit[i] != i)
+                    this->swapPositions(i, this->qubit[i]);
+        }
+};
+
+//The native register replays circuits tile by tile, see TiledReplay
+template <typename Amplitude>
+void replay_circuit(const Circuit& circuit, BasicNativeRegister<Amplitude>* reg) {
+    TiledReplay<Amplitude>(reg).run(circuit);
+}
+
+//Records the circuit of Simon's algorithm up to the measurement, for N + M qubits and the ancillas of the oracle
+template <size_t N, size_t M, typename Oracle>
+Circuit record_simon_circuit(Oracle oracle) {
+    CircuitRecorder recorder(N + M + oracle_ancillas(oracle));
+    run_simon_circuit<N>(&recorder, oracle);
+    return recorder.takeCircuit();
+}
+
+//Oracle of Simon's algorithm replaying a circuit, the qubits of the circuit above the N + M qubits of the query are ancillas
+struct CircuitOracle {
+    std::shared_ptr<const Circuit> circuit;
+    size_t ancilla_count;
+
+    inline size_t ancillas() const {
+        return this->ancilla_count;
+    }
+
+    inline bool realGates() const {
+        return circuit_is_real(*this->circuit);
+    }
+
+    template <typename Reg>
+    void operator()(Reg* reg) const {
+        replay_circuit(*this->circuit, reg);
+    }
+};
+
+//Extracts the oracle from the circuit of a query of Simon's algorithm with N input qubits and M output qubits,
+//by removing the Hadamard layers on the input qubits at its start and at its end
+template <size_t N, size_t M>
+CircuitOracle simon_oracle_of(const Circuit& circuit) {
+    if(circuit.width < N + M)
+        throw std::runtime_error("Circuit of " + std::to_string(circuit.width) + " qubits too small for a query of " + std::to_string(N + M) + " qubits");
+    const uint64_t inputs = (1ull << N) - 1;
+    size_t begin = 0;
+    uint64_t leading = 0;
+    while(begin < circuit.gates.size() && circuit.gates[begin].kind == GateKind::HadamardLayer && leading != inputs)
+        leading ^= circuit.gates[begin++].mask;
+    size_t end = circuit.gates.size();
+    uint64_t trailing = 0;
+    while(end > begin && circuit.gates[end - 1].kind == GateKind::HadamardLayer && trailing != inputs)
+        trailing ^= circuit.gates[--end].mask;
+    if(leading != inputs || trailing != inputs)
+        throw std::runtime_error("Circuit does not start and end with Hadamard gates on the " + std::to_string(N) + " input qubits");
+
+    auto oracle = std::make_shared<Circuit>(Circuit{circuit.width, {circuit.gates.begin() + begin, circuit.gates.begin() + end}});
+    return {oracle, circuit.width - N - M};
+}
+
+//Oracle recording another oracle on its first application, and replaying the optimised and scheduled circuit on every application
+//Copies share the recorded circuit, so all queries of a detection record once. Without a circuit, the oracle is applied directly
+template <typename Oracle>
+struct CachedOracle {
+    Oracle oracle;
+    std::shared_ptr<Circuit> circuit;
+
+    inline size_t ancillas() const {
+        return oracle_ancillas(this->oracle);
+    }
+
+    //The recorded circuit once there is one, the oracle itself before
+    inline bool realGates() const {
+        if(this->circuit && this->circuit->width != 0)
+            return circuit_is_real(*this->circuit);
+        return oracle_is_real(this->oracle);
+    }
+
+    template <typename Reg>
+    void operator()(Reg* reg) const {
+        if(!this->circuit) {
+            this->oracle(reg);
+            return;
+        }
+
+        if(this->circuit->width != register_width(reg)) {
+            QA_TRACE_SCOPE("circuit", "record");
+            CircuitRecorder recorder(register_width(reg));
+            this->oracle(&recorder);
+            *this->circuit = schedule_circuit(optimize_circuit(recorder.getCircuit()));
+        }
+        replay_circuit(*this->circuit, reg);
+    }
+};
+
+//Oracle factory wrapping the oracles of another factory into CachedOracle, caching the circuits only when enabled
+template <typename OracleFactory>
+struct CachingOracleFactory {
+    OracleFactory factory;
+    bool enabled;
+
+    template <typename... Args>
+    auto operator()(const Args&... args) const {
+        using Oracle = decltype(this->factory(args...));
+        return CachedOracle<Oracle>{this->factory(args...), this->enabled ? std::make_shared<Circuit>(Circuit{0, {}}) : nullptr};
+    }
+};
+
+#endif
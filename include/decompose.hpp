@@ -0,0 +1,225 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_DECOMPOSE
+#define QUANTUM_CRYPTO_ATTACK_DECOMPOSE
+
+//Decomposition of toffoli gates with many controls into V-chains of toffoli gates with two controls
+//DecomposingRegister wraps any register type, and rewrites every toffoli with n > 2 controls it receives:
+// - Dirty: 4(n - 2) gates, borrowing n - 2 qubits of the register which are not used by the gate, in any state, and restoring them
+// - Clean: 2n - 3 gates, using n - 2 ancilla qubits in state |0> reserved at the top of the register, and restoring them
+//DecomposedOracle applies an oracle through a DecomposingRegister, and reserves the clean ancillas through oracle_ancillas,
+//so the decomposition is selected per oracle and the ancillas are allocated by run_simon
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "quantum.hpp"
+#include "simon.hpp"
+
+//Selects how toffoli gates with more than two controls are applied
+enum class ToffoliDecomposition {
+    //Applied as a single gate
+    None,
+    //V-chain over borrowed qubits in any state
+    Dirty,
+    //V-chain over reserved ancillas in state |0>
+    Clean
+};
+
+//Gates applied by DecomposingRegister to the wrapped register
+//These bypass the apply_* helpers, so the instrumentation counts every logical gate once, before its decomposition
+inline void forward_sigma_x(quantum_reg* reg, size_t target) {
+    quantum_sigma_x(target, reg);
+}
+
+template <typename Reg>
+inline void forward_sigma_x(Reg* reg, size_t target) {
+    reg->sigmaX(target);
+}
+
+inline void forward_hadamard(quantum_reg* reg, size_t target) {
+    quantum_hadamard(target, reg);
+}
+
+template <typename Reg>
+inline void forward_hadamard(Reg* reg, size_t target) {
+    reg->hadamard(target);
+}
+
+//Toffoli gate with at most two controls
+inline void forward_toffoli(quantum_reg* reg, const size_t* controls, size_t count, size_t target) {
+    if(count == 0)
+        quantum_sigma_x(target, reg);
+    else if(count == 1)
+        quantum_cnot(controls[0], target, reg);
+    else
+        quantum_toffoli(controls[0], controls[1], target, reg);
+}
+
+template <typename Reg>
+inline void forward_toffoli(Reg* reg, const size_t* controls, size_t count, size_t target) {
+    reg->toffoli(controls, count, target);
+}
+
+//Register adapter decomposing toffoli gates with more than two controls, see ToffoliDecomposition
+//Qubits [0, width) are available to the circuit, qubits [width, width + clean) are clean ancillas only used by the decomposition
+template <typename Reg>
+class DecomposingRegister {
+    private:
+        Reg* reg;
+        ToffoliDecomposition mode;
+        size_t width;
+        size_t clean;
+        //Ancillas of the decomposition of the current gate
+        std::vector<size_t> ancillas;
+
+        inline void toffoli2(size_t first, size_t second, size_t target) {
+            const size_t controls[] = {first, second};
+            forward_toffoli(this->reg, controls, 2, target);
+        }
+
+        //Selects n - 2 qubits of the register which are not used by the gate
+        void borrowAncillas(const size_t* controls, size_t count, size_t target) {
+            this->ancillas.clear();
+            for(size_t qubit = 0; qubit < this->width && this->ancillas.size() < count - 2; ++qubit) {
+                bool used = qubit == target;
+                for(size_t i = 0; i < count && !used; ++i)
+                    used = controls[i] == qubit;
+                if(!used)
+                    this->ancillas.push_back(qubit);
+            }
+            if(this->ancillas.size() < count - 2)
+                throw std::runtime_error("Not enough qubits to borrow for a toffoli gate with " + std::to_string(count) + " controls");
+        }
+
+        //Toggles ancilla i by the and of control i + 1 and ancilla i - 1, or ancilla 0 by the and of the first two controls
+        //After the steps 0 to i, with clean ancillas, ancilla i holds the and of the controls 0 to i + 1
+        inline void ancillaStep(const size_t* controls, size_t i) {
+            if(i == 0)
+                this->toffoli2(controls[0], controls[1], this->ancillas[0]);
+            else
+                this->toffoli2(controls[i + 1], this->ancillas[i - 1], this->ancillas[i]);
+        }
+
+        //Runs the steps of the ancillas from the top one down to ancilla 0, and up to the top one again
+        void ladder(const size_t* controls, size_t top) {
+            for(size_t i = top; i > 0; --i)
+                this->ancillaStep(controls, i);
+            this->ancillaStep(controls, 0);
+            for(size_t i = 1; i <= top; ++i)
+                this->ancillaStep(controls, i);
+        }
+
+        //Barenco et al. lemma 7.2: the ancillas may be in any state, and are restored
+        //The first ladder toggles the target by the and of the controls and by the junk of the top ancilla, the second ladder restores the ancillas
+        void toffoliDirty(const size_t* controls, size_t count, size_t target) {
+            this->borrowAncillas(controls, count, target);
+            const size_t top = count - 3;
+            this->toffoli2(controls[count - 1], this->ancillas[top], target);
+            this->ladder(controls, top);
+            this->toffoli2(controls[count - 1], this->ancillas[top], target);
+            this->ladder(controls, top);
+        }
+
+        //Computes the and of all controls into the clean ancillas, toggles the target, and uncomputes the ancillas
+        void toffoliClean(const size_t* controls, size_t count, size_t target) {
+            if(this->clean < count - 2)
+                throw std::runtime_error("Not enough clean ancillas for a toffoli gate with " + std::to_string(count) + " controls");
+            this->ancillas.clear();
+            for(size_t i = 0; i < count - 2; ++i)
+                this->ancillas.push_back(this->width + i);
+
+            for(size_t i = 0; i < count - 2; ++i)
+                this->ancillaStep(controls, i);
+            this->toffoli2(controls[count - 1], this->ancillas[count - 3], target);
+            for(size_t i = count - 2; i > 0; --i)
+                this->ancillaStep(controls, i - 1);
+        }
+    public:
+        DecomposingRegister(Reg* reg, ToffoliDecomposition mode, size_t width, size_t clean) : reg(reg), mode(mode), width(width), clean(clean) {}
+
+        void hadamard(size_t target) {
+            forward_hadamard(this->reg, target);
+        }
+
+        void sigmaX(size_t target) {
+            forward_sigma_x(this->reg, target);
+        }
+
+        void toffoli(const size_t* controls, size_t count, size_t target) {
+            if(count <= 2 || this->mode == ToffoliDecomposition::None)
+                forward_toffoli(this->reg, controls, count, target);
+            else if(this->mode == ToffoliDecomposition::Dirty)
+                this->toffoliDirty(controls, count, target);
+            else
+                this->toffoliClean(controls, count, target);
+        }
+};
+
+template <typename T, typename = void>
+struct HasMaxControls : std::false_type {};
+
+template <typename T>
+struct HasMaxControls<T, std::void_t<decltype(std::declval<const T&>().maxControls())>> : std::true_type {};
+
+//Number of controls of the largest toffoli gate of an oracle for Simon's algorithm with N input qubits
+//Oracles may declare it with a maxControls() member function, otherwise gates are assumed to be controlled by at most all N input qubits
+template <size_t N, typename T>
+size_t oracle_max_controls(const T& oracle) {
+    if constexpr(HasMaxControls<T>::value)
+        return oracle.maxControls();
+    else
+        return N;
+}
+
+//Oracle applying another oracle with its toffoli gates decomposed, for Simon's algorithm with N input qubits
+//In Clean mode, the ancillas for the largest gate of the oracle are reserved above the ancillas of the oracle itself
+template <ToffoliDecomposition Mode, size_t N, typename Oracle>
+struct DecomposedOracle {
+    Oracle oracle;
+
+    inline size_t cleanAncillas() const {
+        size_t controls = oracle_max_controls<N>(this->oracle);
+        return Mode == ToffoliDecomposition::Clean && controls > 2 ? controls - 2 : 0;
+    }
+
+    inline size_t ancillas() const {
+        return oracle_ancillas(this->oracle) + this->cleanAncillas();
+    }
+
+    template <typename Reg>
+    void operator()(Reg* reg) const {
+        size_t clean = this->cleanAncillas();
+        DecomposingRegister<Reg> decomposing(reg, Mode, register_width(reg) - clean, clean);
+        this->oracle(&decomposing);
+    }
+};
+
+//Oracle factory wrapping the oracles of another factory into DecomposedOracle, see run_feistel_detect
+template <ToffoliDecomposition Mode, size_t N, typename OracleFactory>
+struct DecomposingOracleFactory {
+    OracleFactory factory;
+
+    template <typename... Args>
+    auto operator()(const Args&... args) const {
+        using Oracle = decltype(this->factory(args...));
+        return DecomposedOracle<Mode, N, Oracle>{this->factory(args...)};
+    }
+};
+
+//Calls visitor with the oracle factory decomposing the oracles of factory in the given mode, or with factory itself for None
+template <size_t N, typename OracleFactory, typename Visitor>
+decltype(auto) dispatch_decomposition(ToffoliDecomposition mode, OracleFactory factory, Visitor&& visitor) {
+    switch(mode) {
+        case ToffoliDecomposition::Dirty:
+            return visitor(DecomposingOracleFactory<ToffoliDecomposition::Dirty, N, OracleFactory>{factory});
+        case ToffoliDecomposition::Clean:
+            return visitor(DecomposingOracleFactory<ToffoliDecomposition::Clean, N, OracleFactory>{factory});
+        default:
+            return visitor(factory);
+    }
+}
+
+#endif
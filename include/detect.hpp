@@ -0,0 +1,276 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_DETECT
+#define QUANTUM_CRYPTO_ATTACK_DETECT
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "feistel.hpp"
+#include "instrument.hpp"
+#include "matrix.hpp"
+#include "native.hpp"
+#include "oracle.hpp"
+#include "qmdd.hpp"
+#include "random.hpp"
+#include "sampler.hpp"
+#include "shard.hpp"
+#include "simon.hpp"
+#include "sparse.hpp"
+#include "trace.hpp"
+
+//Selects how the measurements of Simon's algorithm are obtained
+enum class Backend {
+    //Simulates the circuit with libquantum
+    LibQuantum,
+    //Simulates the circuit with our dense state vector simulator, see NativeRegister
+    Native,
+    //Draws measurements classically from the output distribution of the circuit, see SimonSampler
+    Sampler,
+    //Simulates the circuit with the dense state vector simulator in single precision, see NativeRegister32
+    Native32,
+    //Simulates the circuit storing only the non-zero amplitudes, switching to the dense simulator once the state fills up, see SparseRegister
+    Sparse,
+    //Simulates the circuit on a decision diagram of the state, experimental, see QmddRegister
+    Qmdd,
+    //Simulates the circuit on a dense state vector sharded over worker processes on the NUMA nodes of the host, see ShardedRegister
+    Sharded
+};
+
+//Outcome of a feistel detection
+enum class DetectionVerdict {
+    //n linearly independent equations were obtained, and the solution s satisfied f(u) = f(u ^ s)
+    SolvedFeistel,
+    //2n equations were attempted without obtaining n linearly independent equations
+    RankDeficientFeistel,
+    //n linearly independent equations were obtained, and the solution s did not satisfy f(u) = f(u ^ s)
+    Random
+};
+
+//Checks whether a verdict classifies the function as a feistel network
+inline bool is_feistel(DetectionVerdict verdict) {
+    return verdict != DetectionVerdict::Random;
+}
+
+//Wall time in seconds spent in the phases of a feistel detection
+struct DetectionTimings {
+    //Construction of the f function and the oracle or sampler
+    double setup;
+    //Runs of Simon's algorithm
+    double simon;
+    //Adding equations to the solver and solving them
+    double solve;
+    //Evaluating f(u) and f(u ^ s)
+    double verify;
+};
+
+//Result of a single feistel detection
+//The detection itself performs no I/O, reporting is left to the functions in report.hpp
+struct DetectionResult {
+    DetectionVerdict verdict;
+    //The solution of the equations in masked encoding (see MatrixSolver::solveEncoded), 0 for RankDeficientFeistel
+    size_t s;
+    //Number of times Simon's algorithm was run
+    size_t queries;
+    //Number of measured equations which were inconsistent with the earlier equations, and were skipped
+    size_t inconsistent;
+    DetectionTimings timings;
+};
+
+//Returns the number of seconds since the given time point, and advances the time point to now
+inline double lap_seconds(std::chrono::steady_clock::time_point& since) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - since).count();
+    since = now;
+    return seconds;
+}
+
+//Whether queries on a backend have to run one at a time, see query_simon
+//libquantum is not re-entrant, its allocation counter in quantum_memman is an unsynchronised global, and its OpenMP builds start a team per gate.
+//A sharded register already runs a spinning worker process per shard, so concurrent queries would oversubscribe the host
+inline bool backend_is_serial(Backend backend) {
+    return backend == Backend::LibQuantum || backend == Backend::Sharded;
+}
+
+//Lock held by the queries of serial backends
+inline std::mutex& serial_backend_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+//Obtains one measurement of Simon's algorithm from the selected backend, as a pair of the measured first and second register
+//The sampler is only used, and required, for Backend::Sampler. Queries of serial backends wait for each other, the other phases of trials still run in parallel
+template <size_t N, size_t M, typename Oracle>
+std::pair<size_t, size_t> query_simon(Backend backend, Oracle oracle, const SimonSampler<N, M>* sampler, RandomStream& rng) {
+    QA_COUNT(SimonQueries, 1);
+    std::unique_lock<std::mutex> serial_lock;
+    if(backend_is_serial(backend))
+        serial_lock = std::unique_lock<std::mutex>(serial_backend_mutex());
+    switch(backend) {
+        case Backend::Sampler: {
+            QA_TIME_SCOPE(Measurement);
+            QA_TRACE_SCOPE("simon", "sample");
+            return sampler->sample(rng);
+        }
+        //Every gate of the register interface and of circuits is real (see gate_kind_is_real), so queries keep a real state,
+        //which needs half the memory and bandwidth of a complex one. The complex registers are only used by the precision mode and the benchmarks
+        case Backend::Native:
+            return run_simon<N, M, RealNativeRegister>(oracle, rng);
+        case Backend::Native32:
+            return run_simon<N, M, RealNativeRegister32>(oracle, rng);
+        case Backend::Sparse:
+            return run_simon<N, M, RealSparseRegister>(oracle, rng);
+        case Backend::Qmdd:
+            return run_simon<N, M, RealQmddRegister>(oracle, rng);
+        case Backend::Sharded:
+            return run_simon<N, M, RealShardedRegister>(oracle, rng);
+        default:
+            return run_simon<N, M>(oracle, rng);
+    }
+}
+
+//Random alpha and beta parameters of the f function of a feistel detection, see run_f
+struct DetectionParameters {
+    size_t alpha;
+    size_t beta;
+};
+
+//Draws the alpha and beta parameters of the given trial
+template <size_t Bits>
+DetectionParameters draw_detection_parameters(const TrialSeed& trial) {
+    RandomStream parameter_rng = trial.stream(RandomStreamId::Parameters);
+    DetectionParameters parameters;
+    parameters.alpha = parameter_rng.uniform(1ull << Bits);
+    parameters.beta = parameter_rng.uniform(1ull << Bits);
+    return parameters;
+}
+
+//Builds the f function of a feistel detection for the given callback, with the given alpha and beta parameters
+template <size_t Bits, typename Func>
+auto make_detection_function(Func internal_callback, const DetectionParameters& parameters) {
+    const size_t ALPHA = parameters.alpha;
+    const size_t BETA = parameters.beta;
+
+    //Generate the f function matching our callback function, using the alpha and beta parameters
+    return [=](size_t input) {
+        return run_f<Bits>(input,
+            internal_callback,
+            ALPHA,
+            BETA
+        );
+    };
+}
+
+//Builds the f function of a feistel detection for the given callback, with the random alpha and beta parameters of the given trial
+template <size_t Bits, typename Func>
+auto make_detection_function(Func internal_callback, const TrialSeed& trial) {
+    return make_detection_function<Bits>(internal_callback, draw_detection_parameters<Bits>(trial));
+}
+
+//Builds the oracle of an f function by enumerating its truth table, see bitflip_oracle
+//Oracle factories are called with the f function and its parameters, and return the oracle used by Simon's algorithm
+template <size_t Bits>
+struct TableOracleFactory {
+    template <typename Func>
+    auto operator()(Func function, const DetectionParameters&) const {
+        return bind_to_bitflip_oracle<Bits + 1, Bits>(function);
+    }
+};
+
+//Runs the feistel detection on an f function built with the parameters of the given trial, see make_detection_function
+//This allows f to be evaluated through a table of its own, all random choices apart from the parameters are drawn from the streams of the trial
+template <size_t Bits, typename Func, typename OracleFactory>
+DetectionResult run_detection(Func function, const DetectionParameters& parameters, OracleFactory make_oracle, const TrialSeed& trial, Backend backend) {
+    DetectionResult result = {DetectionVerdict::RankDeficientFeistel, 0, 0, 0, {0, 0, 0, 0}};
+    std::chrono::steady_clock::time_point phase_start = std::chrono::steady_clock::now();
+
+    RandomStream verification_rng = trial.stream(RandomStreamId::Verification);
+    RandomStream measurement_rng = trial.stream(RandomStreamId::Measurement);
+
+    //Create the bitflip oracle matching the f function
+    auto oracle = make_oracle(function, parameters);
+
+    //The sampler tabulates f once, and is reused for all runs of Simon's algorithm
+    std::optional<SimonSampler<Bits + 1, Bits>> sampler;
+    if(backend == Backend::Sampler)
+        sampler.emplace(function);
+
+    MatrixSolver<Bits> solver;
+    result.timings.setup = lap_seconds(phase_start);
+
+    //Attempt at most 2n runs of Simons algorithm
+    for(size_t i = 0; i < 2*Bits; ++i) {
+        try {
+            //Run simons algorithm
+            std::pair<size_t, size_t> measurements = query_simon<Bits + 1, Bits>(backend, oracle, sampler ? &*sampler : nullptr, measurement_rng);
+            ++result.queries;
+            result.timings.simon += lap_seconds(phase_start);
+
+            //Obtain the observed result from the first register, and add it as a linear equation
+            size_t j = measurements.first;
+            size_t independent_rows;
+            {
+                QA_TIME_SCOPE(Solve);
+                solver.addRow(j);
+                independent_rows = solver.getIndependent();
+            }
+
+            //Check the number of linearly independent rows, if this equals n, start equation solving
+            if(independent_rows == Bits) {
+                //Solve the equation
+                size_t s;
+                {
+                    QA_TIME_SCOPE(Solve);
+                    s = solver.solveEncoded();
+                }
+                result.s = s;
+                result.timings.solve += lap_seconds(phase_start);
+
+                //Generate a random bitstring u
+                size_t u = verification_rng.uniform(1ull << (Bits+1));
+
+                //Check if f(u) == f(u ^ s), and draw conclusions
+                size_t f_u, f_u_s;
+                {
+                    QA_TIME_SCOPE(Verify);
+                    f_u = function(u);
+                    f_u_s = function(u ^ s);
+                }
+
+                result.verdict = f_u == f_u_s ? DetectionVerdict::SolvedFeistel : DetectionVerdict::Random;
+                result.timings.verify = lap_seconds(phase_start);
+                return result;
+            }
+            result.timings.solve += lap_seconds(phase_start);
+        }
+        catch(const InvalidEquation&) {
+            //Skip invalid equations, note that this should not happen for valid Feistel networks
+            //Skipped equations are retried at most 2n times, so a run of inconsistent measurements cannot loop forever
+            ++result.inconsistent;
+            result.timings.solve += lap_seconds(phase_start);
+            if(result.inconsistent <= 2*Bits)
+                --i;
+        }
+    }
+    //More than 2n equations tried, guess the function to be a feistel
+    result.verdict = DetectionVerdict::RankDeficientFeistel;
+    return result;
+}
+
+//Runs the feistel detection quantum algorithm as described in section 3 of the paper
+//The parameter denotes the function to verify, all random choices are drawn from the streams of the given trial
+//The backend parameter selects how the measurements of Simon's algorithm are obtained, the oracle factory how the circuits build the oracle
+template <size_t Bits, typename Func, typename OracleFactory>
+DetectionResult run_feistel_detect(Func internal_callback, OracleFactory make_oracle, const TrialSeed& trial, Backend backend) {
+    DetectionParameters parameters = draw_detection_parameters<Bits>(trial);
+    return run_detection<Bits>(make_detection_function<Bits>(internal_callback, parameters), parameters, make_oracle, trial, backend);
+}
+
+//Runs the feistel detection with the bitflip oracle built from the truth table of the f function
+template <size_t Bits, typename Func>
+DetectionResult run_feistel_detect(Func internal_callback, const TrialSeed& trial, Backend backend = Backend::LibQuantum) {
+    return run_feistel_detect<Bits>(internal_callback, TableOracleFactory<Bits>(), trial, backend);
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_DISPATCH
+#define QUANTUM_CRYPTO_ATTACK_DISPATCH
+
+//Runtime selection of the compile-time problem size
+//The attack pipeline is instantiated for every half block size in [QA_MIN_BITS, QA_MAX_BITS], so every size keeps fully specialised inner loops,
+//while the size to run is chosen at run time. The range can be changed at build time, see the Makefile
+
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#ifndef QA_MIN_BITS
+#define QA_MIN_BITS 2
+#endif
+
+#ifndef QA_MAX_BITS
+#define QA_MAX_BITS 16
+#endif
+
+//Resource estimation with the structured oracle never simulates a register, so it is instantiated for larger sizes, up to QA_MAX_ESTIMATE_BITS
+#ifndef QA_MAX_ESTIMATE_BITS
+#define QA_MAX_ESTIMATE_BITS 32
+#endif
+
+static_assert(QA_MIN_BITS >= 1 && QA_MIN_BITS <= QA_MAX_BITS, "Invalid range of supported half block sizes");
+static_assert(QA_MAX_ESTIMATE_BITS >= QA_MAX_BITS && QA_MAX_ESTIMATE_BITS < 64, "Invalid largest estimated half block size");
+
+//Checks whether the attack was built for the given half block size
+inline bool bits_supported(size_t bits) {
+    return bits >= QA_MIN_BITS && bits <= QA_MAX_BITS;
+}
+
+//Calls visitor with std::integral_constant<size_t, bits>, where bits is known to be in [Min, Max]
+template <size_t Min, size_t Max, typename Visitor>
+decltype(auto) dispatch_bits_in_range(size_t bits, Visitor&& visitor) {
+    if constexpr(Min == Max)
+        return visitor(std::integral_constant<size_t, Min>());
+    else {
+        if(bits == Min)
+            return visitor(std::integral_constant<size_t, Min>());
+        return dispatch_bits_in_range<Min + 1, Max>(bits, visitor);
+    }
+}
+
+//Calls visitor with std::integral_constant<size_t, bits>, for a bits value in [Min, Max]
+template <size_t Min, size_t Max, typename Visitor>
+decltype(auto) dispatch_bits(size_t bits, Visitor&& visitor) {
+    if(bits < Min || bits > Max)
+        throw std::runtime_error("Unsupported number of bits: " + std::to_string(bits) + ", supported are " + std::to_string(Min) + " to " + std::to_string(Max));
+    return dispatch_bits_in_range<Min, Max>(bits, visitor);
+}
+
+//Calls visitor with std::integral_constant<size_t, bits>, for a bits value in the range of sizes this binary was built for
+template <typename Visitor>
+decltype(auto) dispatch_bits(size_t bits, Visitor&& visitor) {
+    return dispatch_bits<QA_MIN_BITS, QA_MAX_BITS>(bits, visitor);
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_ESTIMATE
+#define QUANTUM_CRYPTO_ATTACK_ESTIMATE
+
+//Resource estimation of the attack circuits
+//ResourceRegister implements the register interface of register.hpp without simulating anything: gates are only counted,
+//so the cost of a circuit is obtained in time linear in its number of gates, for registers far too wide to simulate
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "random.hpp"
+#include "simon.hpp"
+
+//Register which counts qubits, gates and depth instead of applying gates
+class ResourceRegister {
+    private:
+        size_t width;
+        uint64_t hadamard_gates;
+        uint64_t sigma_x_gates;
+        //Number of toffoli gates by their number of controls, index 1 are CNOTs
+        std::vector<uint64_t> toffoli_controls;
+        uint64_t measurements;
+        //Depth of the circuit at every qubit, gates are scheduled as soon as all of their qubits are free
+        std::vector<uint64_t> qubit_depth;
+        uint64_t depth;
+
+        inline void schedule(size_t qubit, uint64_t layer) {
+            this->qubit_depth[qubit] = layer;
+            this->depth = std::max(this->depth, layer);
+        }
+    public:
+        explicit ResourceRegister(size_t width) : width(width), hadamard_gates(0), sigma_x_gates(0), measurements(0), qubit_depth(width, 0), depth(0) {}
+
+        void hadamard(size_t target) {
+            ++this->hadamard_gates;
+            this->schedule(target, this->qubit_depth[target] + 1);
+        }
+
+        void sigmaX(size_t target) {
+            ++this->sigma_x_gates;
+            this->schedule(target, this->qubit_depth[target] + 1);
+        }
+
+        void toffoli(const size_t* controls, size_t count, size_t target) {
+            if(this->toffoli_controls.size() <= count)
+                this->toffoli_controls.resize(count + 1, 0);
+            ++this->toffoli_controls[count];
+
+            uint64_t layer = this->qubit_depth[target];
+            for(size_t i = 0; i < count; ++i)
+                layer = std::max(layer, this->qubit_depth[controls[i]]);
+            ++layer;
+            for(size_t i = 0; i < count; ++i)
+                this->schedule(controls[i], layer);
+            this->schedule(target, layer);
+        }
+
+        //Counts a measurement of the full register, the outcome is always 0
+        size_t measure(RandomStream&) {
+            ++this->measurements;
+            std::fill(this->qubit_depth.begin(), this->qubit_depth.end(), ++this->depth);
+            return 0;
+        }
+
+        inline size_t getWidth() const {
+            return this->width;
+        }
+
+        inline uint64_t getHadamardGates() const {
+            return this->hadamard_gates;
+        }
+
+        inline uint64_t getSigmaXGates() const {
+            return this->sigma_x_gates;
+        }
+
+        inline const std::vector<uint64_t>& getToffoliControls() const {
+            return this->toffoli_controls;
+        }
+
+        inline uint64_t getMeasurements() const {
+            return this->measurements;
+        }
+
+        //Depth of the circuit in gates as applied, before decomposing multi-controlled toffoli gates
+        inline uint64_t getDepth() const {
+            return this->depth;
+        }
+
+        //Number of toffoli gates with any number of controls
+        uint64_t getToffoliGates() const {
+            uint64_t total = 0;
+            for(uint64_t gates : this->toffoli_controls)
+                total += gates;
+            return total;
+        }
+
+        //T gates after decomposing every gate into Clifford+T
+        //A toffoli with n >= 2 controls is decomposed into 2n - 3 toffoli gates with two controls using n - 2 clean ancillas,
+        //each of which takes 7 T gates, gates with fewer controls are Clifford gates
+        uint64_t getTCount() const {
+            uint64_t total = 0;
+            for(size_t controls = 2; controls < this->toffoli_controls.size(); ++controls)
+                total += this->toffoli_controls[controls] * 7 * (2 * controls - 3);
+            return total;
+        }
+
+        //Ancilla qubits needed by the decomposition of getTCount, which can be shared by all gates
+        size_t getAncillas() const {
+            for(size_t controls = this->toffoli_controls.size(); controls > 2; --controls) {
+                if(this->toffoli_controls[controls - 1] != 0)
+                    return controls - 3;
+            }
+            return 0;
+        }
+};
+
+//Counts the resources of a single run of Simon's algorithm with the given oracle, on N + M qubits and the ancillas of the oracle
+template <size_t N, size_t M, typename Oracle>
+ResourceRegister estimate_simon_query(Oracle oracle) {
+    ResourceRegister reg(N + M + oracle_ancillas(oracle));
+    run_simon_circuit<N>(&reg, oracle);
+
+    RandomStream unused(0, 0, RandomStreamId::Measurement);
+    reg.measure(unused);
+    return reg;
+}
+
+#endif
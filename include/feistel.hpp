@@ -1,19 +1,22 @@
 #ifndef QUANTUM_CRYPTO_ATTACK_FEISTEL
 #define QUANTUM_CRYPTO_ATTACK_FEISTEL
 
+#include <algorithm>
 #include <array>
+#include <functional>
+#include <vector>
 
 
-//Runs a feistel encryption routine using the given keys and round function
-template <size_t Bits, size_t Rounds, typename Func>
-size_t run_feistel_encrypt(size_t input, Func round_function, const std::array<size_t, Rounds>& keys) {
+//Runs a feistel encryption routine using the round function and count keys, one round for every key
+template <size_t Bits, typename Func>
+size_t run_feistel_encrypt_rounds(size_t input, Func round_function, const size_t* keys, size_t count) {
     size_t r_mask = (1ull << Bits) - 1;
     size_t l_mask = r_mask << Bits;
 
     size_t r = input & r_mask;
     size_t l = (input & l_mask) >> Bits;
 
-    for(size_t i = 0; i < keys.size(); ++i) {
+    for(size_t i = 0; i < count; ++i) {
         size_t next_l = r;
         size_t next_r = l ^ round_function(r, keys[i]);
 
@@ -24,18 +27,18 @@ size_t run_feistel_encrypt(size_t input, Func round_function, const std::array<s
     return r | (l << Bits);
 }
 
-//Runs a feistel decryption routine using the given keys and round function
-template <size_t Bits, size_t Rounds, typename Func>
-size_t run_feistel_decrypt(size_t input, Func round_function, const std::array<size_t, Rounds>& keys) {
+//Runs a feistel decryption routine using the round function and count keys, one round for every key
+template <size_t Bits, typename Func>
+size_t run_feistel_decrypt_rounds(size_t input, Func round_function, const size_t* keys, size_t count) {
     size_t r_mask = (1ull << Bits) - 1;
     size_t l_mask = r_mask << Bits;
 
     size_t r = input & r_mask;
     size_t l = (input & l_mask) >> Bits;
 
-    for(size_t i = 0; i < keys.size(); ++i) {
+    for(size_t i = 0; i < count; ++i) {
         size_t prev_r = l;
-        size_t prev_l = r ^ round_function(l, keys[keys.size() - 1 - i]);
+        size_t prev_l = r ^ round_function(l, keys[count - 1 - i]);
 
         r = prev_r;
         l = prev_l;
@@ -44,12 +47,67 @@ size_t run_feistel_decrypt(size_t input, Func round_function, const std::array<s
     return r | (l << Bits);
 }
 
+//Runs a feistel encryption routine using the given keys and round function
+template <size_t Bits, size_t Rounds, typename Func>
+size_t run_feistel_encrypt(size_t input, Func round_function, const std::array<size_t, Rounds>& keys) {
+    return run_feistel_encrypt_rounds<Bits>(input, round_function, keys.data(), keys.size());
+}
+
+//Runs a feistel decryption routine using the given keys and round function
+template <size_t Bits, size_t Rounds, typename Func>
+size_t run_feistel_decrypt(size_t input, Func round_function, const std::array<size_t, Rounds>& keys) {
+    return run_feistel_decrypt_rounds<Bits>(input, round_function, keys.data(), keys.size());
+}
+
+//Runs a feistel encryption routine with a number of rounds chosen at run time, one round for every key
+template <size_t Bits, typename Func>
+size_t run_feistel_encrypt(size_t input, Func round_function, const std::vector<size_t>& keys) {
+    return run_feistel_encrypt_rounds<Bits>(input, round_function, keys.data(), keys.size());
+}
+
+//Runs a feistel decryption routine with a number of rounds chosen at run time, one round for every key
+template <size_t Bits, typename Func>
+size_t run_feistel_decrypt(size_t input, Func round_function, const std::vector<size_t>& keys) {
+    return run_feistel_decrypt_rounds<Bits>(input, round_function, keys.data(), keys.size());
+}
+
 //Utility function to bind keys and round function to the feistel function, resulting in a function f(input) performing the feistel network
 template <size_t Bits, size_t Rounds, typename Func>
 auto make_feistel_encrypt(Func round_function, const std::array<size_t, Rounds>& keys) {
     return std::bind(run_feistel_encrypt<Bits, Rounds, Func>, std::placeholders::_1, round_function, keys);
 }
 
+//Utility function to bind keys and round function to the feistel function, with a number of rounds chosen at run time
+template <size_t Bits, typename Func>
+auto make_feistel_encrypt(Func round_function, const std::vector<size_t>& keys) {
+    return [round_function, keys](size_t input) {
+        return run_feistel_encrypt<Bits>(input, round_function, keys);
+    };
+}
+
+//Round function of a substitution-permutation network, used as the round function of the attacked feistel networks
+//The key is added to the input, every width-bit chunk is substituted by the S-box, and the result is rotated left by one bit to mix the chunks.
+//A last chunk narrower than width uses the low bits of the S-box. With width >= Bits this is the single lookup sbox[input ^ key]
+template <size_t Bits>
+struct SpnRoundFunction {
+    //S-box of 2^width entries
+    const size_t* sbox;
+    size_t width;
+
+    size_t operator()(size_t input, size_t key) const {
+        if(this->width >= Bits)
+            return this->sbox[input ^ key];
+
+        size_t x = input ^ key;
+        size_t result = 0;
+        for(size_t offset = 0; offset < Bits; offset += this->width) {
+            size_t chunk_mask = (1ull << std::min(this->width, Bits - offset)) - 1;
+            result |= (this->sbox[(x >> offset) & chunk_mask] & chunk_mask) << offset;
+        }
+        return ((result << 1) | (result >> (Bits - 1))) & ((1ull << Bits) - 1);
+    }
+};
+
 //Runs the f function described in section 3 of the paper, using the given alpha and beta values
 //In this case, the callback parameter contains the oracle V
 template <size_t Bits, typename Func>
@@ -0,0 +1,136 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_FEISTEL_ORACLE
+#define QUANTUM_CRYPTO_ATTACK_FEISTEL_ORACLE
+
+//Structured bitflip oracle of the f function of a feistel detection, compiled round by round from the feistel network
+//bitflip_oracle enumerates all 2^N inputs of a function. FeistelOracle instead computes the network in place: the right half lives in
+//Bits ancilla qubits, every round xors the round function into the other half, the output is copied into the second register,
+//and the rounds are undone. The round function is an SPN round (see SpnRoundFunction), so every round costs one truth table per S-box chunk,
+//and the number of gates is polynomial in Bits and the number of rounds for a fixed S-box width
+
+#include <algorithm>
+#include <vector>
+
+#include "register.hpp"
+#include "toffoli.hpp"
+
+//Largest S-box width supported by the structured oracle, a truth table of 2^width entries is emitted per chunk
+constexpr size_t FEISTEL_ORACLE_MAX_SBOX_WIDTH = 16;
+
+//S-box width used with the structured oracle unless one is given, so its gate count stays polynomial in the half block size
+constexpr size_t FEISTEL_ORACLE_DEFAULT_SBOX_WIDTH = 4;
+
+//Xors the S-box substitution of the width-bit chunk at bit chunk of the source half into the target half, rotated as in SpnRoundFunction
+//Every output bit of every S-box entry toggles its target bit if the chunk matches the entry
+template <size_t Bits, typename Reg>
+void apply_sbox_chunk(Reg* reg, const size_t* sbox, size_t width, bool rotate, size_t source, size_t chunk, size_t target) {
+    size_t offset = source + chunk;
+    size_t controls[FEISTEL_ORACLE_MAX_SBOX_WIDTH];
+    for(size_t i = 0; i < width; ++i)
+        controls[i] = offset + i;
+
+    for(size_t value = 0; value < (1ull << width); ++value) {
+        size_t output = sbox[value] & ((1ull << width) - 1);
+        if(output == 0)
+            continue;
+
+        //Flip the bits which are 0 in value, so the controls are all ones if and only if the chunk equals value
+        for(size_t i = 0; i < width; ++i) {
+            if(!(value & (1ull << i)))
+                apply_sigma_x(reg, offset + i);
+        }
+        for(size_t j = 0; j < width; ++j) {
+            if(!(output & (1ull << j)))
+                continue;
+            size_t bit = rotate ? (chunk + j + 1) % Bits : chunk + j;
+            create_nbit_toffoli_runtime<FEISTEL_ORACLE_MAX_SBOX_WIDTH>(reg, target + bit, controls, width);
+        }
+        for(size_t i = 0; i < width; ++i) {
+            if(!(value & (1ull << i)))
+                apply_sigma_x(reg, offset + i);
+        }
+    }
+}
+
+//Xors the round function SpnRoundFunction(source, key) into target, where source and target are the offsets of two Bits-qubit halves
+//Leaves source unchanged, so applying it twice is the identity
+template <size_t Bits, typename Reg>
+void apply_feistel_round(Reg* reg, const size_t* sbox, size_t sbox_width, size_t key, size_t source, size_t target) {
+    //Add the key to the source half, and remove it again after the substitution
+    for(size_t i = 0; i < Bits; ++i) {
+        if(key & (1ull << i))
+            apply_sigma_x(reg, source + i);
+    }
+
+    bool rotate = sbox_width < Bits;
+    for(size_t offset = 0; offset < Bits; offset += sbox_width)
+        apply_sbox_chunk<Bits>(reg, sbox, std::min(sbox_width, Bits - offset), rotate, source, offset, target);
+
+    for(size_t i = 0; i < Bits; ++i) {
+        if(key & (1ull << i))
+            apply_sigma_x(reg, source + i);
+    }
+}
+
+//Xors alpha into the Bits qubits at target when the control qubit is 0, and beta when it is 1
+template <size_t Bits, typename Reg>
+void apply_controlled_mask(Reg* reg, size_t control, size_t alpha, size_t beta, size_t target) {
+    for(size_t i = 0; i < Bits; ++i) {
+        if((alpha ^ beta) & (1ull << i))
+            create_nbit_toffoli<1>(reg, target + i, {control});
+        if(alpha & (1ull << i))
+            apply_sigma_x(reg, target + i);
+    }
+}
+
+//Structured oracle |x>|y>|0> -> |x>|y xor f(x)>|0> of the f function of a feistel detection, see run_f
+//The register holds the Bits + 1 qubits of x, the Bits qubits of y and Bits ancilla qubits in state |0>
+//Qubit 0 of x selects between alpha and beta, qubits [1, Bits] hold the left half of the feistel input
+template <size_t Bits>
+struct FeistelOracle {
+    //S-box of the SpnRoundFunction of the network, and its width
+    const size_t* sbox;
+    size_t sbox_width;
+    //Round keys of the network, one round for every key
+    std::vector<size_t> keys;
+    size_t alpha;
+    size_t beta;
+
+    inline size_t ancillas() const {
+        return Bits;
+    }
+
+    //Controls of the largest toffoli gate, one per bit of an S-box chunk
+    inline size_t maxControls() const {
+        return std::max<size_t>(this->sbox_width, 1);
+    }
+
+    template <typename Reg>
+    void operator()(Reg* reg) const {
+        const size_t selector = 0;
+        const size_t output = Bits + 1;
+        const size_t ancilla = 2 * Bits + 1;
+
+        //The left half of the network is computed in place on x, the right half starts as alpha or beta in the ancillas
+        size_t left = 1;
+        size_t right = ancilla;
+        apply_controlled_mask<Bits>(reg, selector, this->alpha, this->beta, right);
+        for(size_t key : this->keys) {
+            apply_feistel_round<Bits>(reg, this->sbox, this->sbox_width, key, right, left);
+            std::swap(left, right);
+        }
+
+        //f(x) is the left half of the output, xored with the mask
+        for(size_t i = 0; i < Bits; ++i)
+            create_nbit_toffoli<1>(reg, output + i, {left + i});
+        apply_controlled_mask<Bits>(reg, selector, this->alpha, this->beta, output);
+
+        //Undo the rounds in reverse order, restoring x and the ancillas
+        for(size_t i = this->keys.size(); i > 0; --i) {
+            std::swap(left, right);
+            apply_feistel_round<Bits>(reg, this->sbox, this->sbox_width, this->keys[i - 1], right, left);
+        }
+        apply_controlled_mask<Bits>(reg, selector, this->alpha, this->beta, right);
+    }
+};
+
+#endif
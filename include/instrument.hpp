@@ -0,0 +1,189 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_INSTRUMENT
+#define QUANTUM_CRYPTO_ATTACK_INSTRUMENT
+
+//Optional instrumentation of the attack pipeline, counting events and timing phases
+//Only compiled in when QA_INSTRUMENT is defined (make INSTRUMENT=1), otherwise QA_COUNT and QA_TIME_SCOPE expand to nothing.
+//Every thread accumulates into its own block, so instrumented hot paths never share cache lines. The blocks are merged when the process
+//exits, which prints a summary to stderr, and writes it as JSON to the file named by the QA_INSTRUMENT_JSON environment variable, if set
+
+#include <cstdint>
+
+//Events counted by the instrumentation
+enum class InstrumentCounter : uint32_t {
+    //Gates applied to a register, by type
+    HadamardGates,
+    SigmaXGates,
+    ToffoliGates,
+    //Evaluations of the classical function while constructing a bitflip oracle
+    OracleEvaluations,
+    //Measurements of Simon's algorithm, by any backend
+    SimonQueries,
+    //Rows added to an equation solver, and the rows among them which were linearly independent
+    RowsAdded,
+    IndependentRows,
+    //Row xors performed by an equation solver
+    SolverXors,
+    Count
+};
+
+//Phases timed by the instrumentation
+enum class InstrumentTimer : uint32_t {
+    //Application of the bitflip oracle
+    Oracle,
+    //The Hadamard layers of Simon's algorithm
+    Hadamard,
+    //Measurement of the register, or drawing a sample from the sampler
+    Measurement,
+    //Adding equations and solving them
+    Solve,
+    //Checking f(u) = f(u ^ s) for a solved equation
+    Verify,
+    //Tabulating a function into a table file
+    TableBuild,
+    Count
+};
+
+inline const char* instrument_counter_name(InstrumentCounter counter) {
+    static const char* const names[] = {
+        "hadamard_gates", "sigma_x_gates", "toffoli_gates", "oracle_evaluations", "simon_queries", "rows_added", "independent_rows", "solver_xors"
+    };
+    return names[static_cast<uint32_t>(counter)];
+}
+
+inline const char* instrument_timer_name(InstrumentTimer timer) {
+    static const char* const names[] = {"oracle", "hadamard", "measurement", "solve", "verify", "table_build"};
+    return names[static_cast<uint32_t>(timer)];
+}
+
+#ifdef QA_INSTRUMENT
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+constexpr size_t INSTRUMENT_COUNTERS = static_cast<size_t>(InstrumentCounter::Count);
+constexpr size_t INSTRUMENT_TIMERS = static_cast<size_t>(InstrumentTimer::Count);
+
+//Counters and timers accumulated by a single thread
+struct alignas(64) InstrumentBlock {
+    uint64_t counters[INSTRUMENT_COUNTERS] = {};
+    //Total nanoseconds and number of timed scopes per timer
+    uint64_t timer_nanoseconds[INSTRUMENT_TIMERS] = {};
+    uint64_t timer_calls[INSTRUMENT_TIMERS] = {};
+};
+
+//Owns the blocks of all threads, blocks outlive their threads so their counts are still reported at exit
+class InstrumentRegistry {
+    private:
+        std::mutex mutex;
+        std::vector<std::unique_ptr<InstrumentBlock>> blocks;
+
+        InstrumentRegistry() = default;
+    public:
+        static InstrumentRegistry& get() {
+            static InstrumentRegistry registry;
+            return registry;
+        }
+
+        ~InstrumentRegistry() {
+            InstrumentBlock total = this->merge();
+            this->printSummary(stderr, total);
+            const char* path = std::getenv("QA_INSTRUMENT_JSON");
+            if(path != nullptr) {
+                FILE* file = std::fopen(path, "w");
+                if(file != nullptr) {
+                    this->printJson(file, total);
+                    std::fclose(file);
+                }
+            }
+        }
+
+        InstrumentBlock* add() {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->blocks.emplace_back(new InstrumentBlock());
+            return this->blocks.back().get();
+        }
+
+        //Sums the blocks of all threads, counts of running threads may be slightly behind
+        InstrumentBlock merge() {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            InstrumentBlock total;
+            for(const std::unique_ptr<InstrumentBlock>& block : this->blocks) {
+                for(size_t i = 0; i < INSTRUMENT_COUNTERS; ++i)
+                    total.counters[i] += block->counters[i];
+                for(size_t i = 0; i < INSTRUMENT_TIMERS; ++i) {
+                    total.timer_nanoseconds[i] += block->timer_nanoseconds[i];
+                    total.timer_calls[i] += block->timer_calls[i];
+                }
+            }
+            return total;
+        }
+
+        void printSummary(FILE* out, const InstrumentBlock& total) {
+            std::fprintf(out, "Instrumentation counters:\n");
+            for(size_t i = 0; i < INSTRUMENT_COUNTERS; ++i)
+                std::fprintf(out, "  %-20s %llu\n", instrument_counter_name(InstrumentCounter(i)), (unsigned long long) total.counters[i]);
+            std::fprintf(out, "Instrumentation timers (summed over threads):\n");
+            for(size_t i = 0; i < INSTRUMENT_TIMERS; ++i)
+                std::fprintf(out, "  %-20s %.6fs in %llu scopes\n", instrument_timer_name(InstrumentTimer(i)), total.timer_nanoseconds[i] * 1e-9,
+                    (unsigned long long) total.timer_calls[i]);
+        }
+
+        void printJson(FILE* out, const InstrumentBlock& total) {
+            std::fprintf(out, "{\"counters\":{");
+            for(size_t i = 0; i < INSTRUMENT_COUNTERS; ++i)
+                std::fprintf(out, "%s\"%s\":%llu", i ? "," : "", instrument_counter_name(InstrumentCounter(i)), (unsigned long long) total.counters[i]);
+            std::fprintf(out, "},\"timers\":{");
+            for(size_t i = 0; i < INSTRUMENT_TIMERS; ++i)
+                std::fprintf(out, "%s\"%s\":{\"seconds\":%.9g,\"calls\":%llu}", i ? "," : "", instrument_timer_name(InstrumentTimer(i)),
+                    total.timer_nanoseconds[i] * 1e-9, (unsigned long long) total.timer_calls[i]);
+            std::fprintf(out, "}}\n");
+        }
+};
+
+//Block of the calling thread, created on first use
+inline InstrumentBlock& instrument_block() {
+    //Make sure the registry is constructed first, so it is destroyed, and reports, after all users
+    static InstrumentRegistry& registry = InstrumentRegistry::get();
+    thread_local InstrumentBlock* block = registry.add();
+    return *block;
+}
+
+inline void instrument_count(InstrumentCounter counter, uint64_t amount) {
+    instrument_block().counters[static_cast<size_t>(counter)] += amount;
+}
+
+//Adds the wall time of its scope to a timer
+class InstrumentScope {
+    private:
+        InstrumentTimer timer;
+        std::chrono::steady_clock::time_point start;
+    public:
+        explicit InstrumentScope(InstrumentTimer timer) : timer(timer), start(std::chrono::steady_clock::now()) {}
+
+        ~InstrumentScope() {
+            InstrumentBlock& block = instrument_block();
+            block.timer_nanoseconds[static_cast<size_t>(this->timer)] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->start).count();
+            ++block.timer_calls[static_cast<size_t>(this->timer)];
+        }
+};
+
+#define QA_INSTRUMENT_CONCAT_INNER(a, b) a##b
+#define QA_INSTRUMENT_CONCAT(a, b) QA_INSTRUMENT_CONCAT_INNER(a, b)
+
+//Adds amount to a counter
+#define QA_COUNT(counter, amount) instrument_count(InstrumentCounter::counter, amount)
+//Times the rest of the enclosing scope
+#define QA_TIME_SCOPE(timer) InstrumentScope QA_INSTRUMENT_CONCAT(instrument_scope_, __LINE__)(InstrumentTimer::timer)
+
+#else
+
+#define QA_COUNT(counter, amount) ((void) 0)
+#define QA_TIME_SCOPE(timer) ((void) 0)
+
+#endif
+
+#endif
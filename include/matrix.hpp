@@ -5,10 +5,21 @@
 #include <vector>
 #include <memory>
 #include <cassert>
+#include <stdexcept>
+
+#include "instrument.hpp"
+#include "trace.hpp"
+
+//Thrown when an added equation contradicts the equations already in the solver
+//The detection skips such equations, so it must be distinguishable from other errors
+struct InvalidEquation : std::runtime_error {
+    InvalidEquation() : std::runtime_error("Invalid equation") {}
+};
 
 //Xors the destination register with the src register
 template <size_t Width>
 inline void xor_vectors(std::array<bool, Width>& dest, const std::array<bool, Width>& src) {
+    QA_COUNT(SolverXors, 1);
     for(size_t i = 0; i < Width; ++i)
         dest[i] ^= src[i];
 }
@@ -76,7 +87,7 @@ class MatrixSolver {
 
             //Check whether we end up with an equation of the form 0 = 1
             if(one_vector(content_copy[this->independent_rows]))
-                throw std::runtime_error("Invalid equation");
+                throw InvalidEquation();
 
             //Check whether independent
             return !zero_vector(content_copy[this->independent_rows]);
@@ -89,7 +100,7 @@ class MatrixSolver {
                 for(size_t j = i; j < this->independent_rows; ++j) {
                     if(this->contents[j][i]) {
                         std::swap(this->contents[j], this->contents[i]);
-                        std::swap(this->targets[j], this->targets[i]);
+                        std::vector<bool>::swap(this->targets[j], this->targets[i]);
                         break;
                     }
                 }
@@ -141,19 +152,23 @@ class MatrixSolver {
 
         //Adds a row, the target is given seperately, and the array denotes the factors of the equation
         void addRow(const std::array<bool, Width>& new_row, bool solution) {
+            QA_TRACE_SCOPE("solver", "addRow");
             this->contents.push_back(new_row);
             this->targets.push_back(solution);
+            QA_COUNT(RowsAdded, 1);
 
             //In case the equation is independent, swap it to the top to use it in later equations
             if(this->independent(this->contents.size() - 1)) {
                 std::swap(this->contents[this->independent_rows], this->contents[this->contents.size()-1]);
-                std::swap(this->targets[this->independent_rows], this->targets[this->contents.size()-1]);
+                std::vector<bool>::swap(this->targets[this->independent_rows], this->targets[this->contents.size()-1]);
                 ++this->independent_rows;
+                QA_COUNT(IndependentRows, 1);
             }
         }
 
         //Solves the set of equations
         std::array<bool, Width> solve() {
+            QA_TRACE_SCOPE("solver", "solve");
             //Assert a valid matrix
             if(this->independent_rows != Width)
                 throw std::runtime_error("Could not solve, invalid number of rows");
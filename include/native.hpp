@@ -0,0 +1,230 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_NATIVE
+#define QUANTUM_CRYPTO_ATTACK_NATIVE
+
+//Dense state vector simulator, storing one amplitude for every basis state of the register
+//Compared to the sparse hash table of libquantum, every gate is a single pass over a flat array, and multi-controlled gates only visit the
+//basis states where all controls are set
+//Amplitudes are complex doubles, or complex floats for NativeRegister32, which halves memory and bandwidth. Simon circuits only consist of
+//Hadamard and X gates, so the only rounding is in the Hadamard gates, and single precision stays accurate far beyond the simulated sizes
+//As these gates have real matrices, the state of a Simon circuit stays real, and RealNativeRegister stores a single real per basis state
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "random.hpp"
+
+//Gate applied by NativeRegister::applyTiles to a qubit inside the tiles
+//A Hadamard gate on bit, or a controlled X gate toggling bit in the basis states whose bits in support equal match
+struct TileGate {
+    bool hadamard;
+    size_t support;
+    size_t match;
+    size_t bit;
+};
+
+//Number of qubits of the tiles of the state vector applyTiles works on, 2^14 amplitudes take 256 KiB and stay in the L2 cache
+constexpr size_t NATIVE_TILE_QUBITS = 14;
+
+//Real type of an amplitude type, the type of the factors of the Hadamard gate
+template <typename Amplitude>
+struct AmplitudeReal {
+    using type = Amplitude;
+};
+
+template <typename Real>
+struct AmplitudeReal<std::complex<Real>> {
+    using type = Real;
+};
+
+//Gate kernels on a flat array of size amplitudes, shared by the native register and the shards of ShardedRegister
+
+template <typename Amplitude>
+void native_hadamard(Amplitude* amplitudes, size_t size, size_t target) {
+    using Real = typename AmplitudeReal<Amplitude>::type;
+    const size_t bit = 1ull << target;
+    const Real factor = std::sqrt(Real(0.5));
+    for(size_t i = 0; i < size; i += bit << 1) {
+        for(size_t j = i; j < i + bit; ++j) {
+            Amplitude a = amplitudes[j];
+            Amplitude b = amplitudes[j + bit];
+            amplitudes[j] = (a + b) * factor;
+            amplitudes[j + bit] = (a - b) * factor;
+        }
+    }
+}
+
+template <typename Amplitude>
+void native_sigma_x(Amplitude* amplitudes, size_t size, size_t target) {
+    const size_t bit = 1ull << target;
+    for(size_t i = 0; i < size; i += bit << 1)
+        for(size_t j = i; j < i + bit; ++j)
+            std::swap(amplitudes[j], amplitudes[j + bit]);
+}
+
+//Toggles target in every basis state where all bits in control_mask are set, and all bits in negated_mask are clear
+template <typename Amplitude>
+void native_toffoli_mask(Amplitude* amplitudes, size_t size, size_t control_mask, size_t target, size_t negated_mask) {
+    const size_t bit = 1ull << target;
+    //Enumerate all subsets of the bits which are neither control nor target, which yields exactly the basis states to swap
+    const size_t free = (size - 1) & ~(control_mask | negated_mask | bit);
+    size_t subset = 0;
+    do {
+        size_t state = subset | control_mask;
+        std::swap(amplitudes[state], amplitudes[state | bit]);
+        subset = (subset - free) & free;
+    } while(subset != 0);
+}
+
+template <typename Amplitude>
+class BasicNativeRegister {
+    private:
+        using Real = typename AmplitudeReal<Amplitude>::type;
+
+        size_t width;
+        std::vector<Amplitude> amplitudes;
+
+    public:
+        //Creates a register of width qubits in basis state initial
+        explicit BasicNativeRegister(size_t width, size_t initial = 0) : width(width) {
+            if(width >= 48)
+                throw std::runtime_error("Register too wide for the native backend");
+            this->amplitudes.assign(1ull << width, 0);
+            this->amplitudes[initial] = 1;
+        }
+
+        inline size_t getWidth() const {
+            return this->width;
+        }
+
+        //Probability of measuring the given basis state
+        inline double probability(size_t state) const {
+            return std::norm(this->amplitudes[state]);
+        }
+
+        inline Amplitude amplitude(size_t state) const {
+            return this->amplitudes[state];
+        }
+
+        inline void setAmplitude(size_t state, Amplitude amplitude) {
+            this->amplitudes[state] = amplitude;
+        }
+
+        void hadamard(size_t target) {
+            native_hadamard(this->amplitudes.data(), this->amplitudes.size(), target);
+        }
+
+        void sigmaX(size_t target) {
+            native_sigma_x(this->amplitudes.data(), this->amplitudes.size(), target);
+        }
+
+        //Toggles target in every basis state where all bits in control_mask are set, and all bits in negated_mask are clear
+        void toffoliMask(size_t control_mask, size_t target, size_t negated_mask = 0) {
+            native_toffoli_mask(this->amplitudes.data(), this->amplitudes.size(), control_mask, target, negated_mask);
+        }
+
+        //Applies gates in order, in a single sweep over tiles of 2^NATIVE_TILE_QUBITS amplitudes, so every tile is loaded into the cache once
+        //Every gate has to act on a qubit inside the tiles, the controls of an X gate outside of the tiles select the tiles it applies to
+        void applyTiles(const TileGate* gates, size_t count) {
+            const size_t tile = std::min(this->amplitudes.size(), size_t(1) << NATIVE_TILE_QUBITS);
+            const Real factor = std::sqrt(Real(0.5));
+            for(size_t base = 0; base < this->amplitudes.size(); base += tile) {
+                for(size_t i = 0; i < count; ++i) {
+                    const TileGate& gate = gates[i];
+                    if(gate.hadamard) {
+                        for(size_t start = base; start < base + tile; start += gate.bit << 1) {
+                            for(size_t j = start; j < start + gate.bit; ++j) {
+                                Amplitude a = this->amplitudes[j];
+                                Amplitude b = this->amplitudes[j + gate.bit];
+                                this->amplitudes[j] = (a + b) * factor;
+                                this->amplitudes[j + gate.bit] = (a - b) * factor;
+                            }
+                        }
+                        continue;
+                    }
+                    if((base & gate.support) != (gate.match & ~(tile - 1)))
+                        continue;
+                    if(gate.support == 0) {
+                        for(size_t start = base; start < base + tile; start += gate.bit << 1)
+                            for(size_t j = start; j < start + gate.bit; ++j)
+                                std::swap(this->amplitudes[j], this->amplitudes[j + gate.bit]);
+                        continue;
+                    }
+                    const size_t match = base | (gate.match & (tile - 1));
+                    const size_t free = (tile - 1) & ~(gate.support | gate.bit);
+                    size_t subset = 0;
+                    do {
+                        size_t state = subset | match;
+                        std::swap(this->amplitudes[state], this->amplitudes[state | gate.bit]);
+                        subset = (subset - free) & free;
+                    } while(subset != 0);
+                }
+            }
+        }
+
+        //Exchanges qubits first and second, which moves the amplitudes of the basis states where the two bits differ
+        void swapQubits(size_t first, size_t second) {
+            const size_t first_bit = 1ull << first;
+            const size_t second_bit = 1ull << second;
+            const size_t free = (this->amplitudes.size() - 1) & ~(first_bit | second_bit);
+            size_t subset = 0;
+            do {
+                std::swap(this->amplitudes[subset | first_bit], this->amplitudes[subset | second_bit]);
+                subset = (subset - free) & free;
+            } while(subset != 0);
+        }
+
+        void toffoli(const size_t* controls, size_t count, size_t target) {
+            size_t control_mask = 0;
+            for(size_t i = 0; i < count; ++i)
+                control_mask |= 1ull << controls[i];
+            this->toffoliMask(control_mask, target);
+        }
+
+        //Samples a measurement of the full register
+        size_t measure(RandomStream& rng) const {
+            double total = 0;
+            for(const Amplitude& amplitude : this->amplitudes)
+                total += std::norm(amplitude);
+
+            double sample = rng.uniformReal() * total;
+            for(size_t i = 0; i < this->amplitudes.size(); ++i) {
+                sample -= std::norm(this->amplitudes[i]);
+                if(sample < 0)
+                    return i;
+            }
+            return this->amplitudes.size() - 1;
+        }
+};
+
+using NativeRegister = BasicNativeRegister<std::complex<double>>;
+using NativeRegister32 = BasicNativeRegister<std::complex<float>>;
+using RealNativeRegister = BasicNativeRegister<double>;
+using RealNativeRegister32 = BasicNativeRegister<float>;
+
+//Deviation between the states of two registers of equal width
+struct PrecisionComparison {
+    //Largest absolute difference of the amplitude of a basis state
+    double max_amplitude_error;
+    //Total variation distance between the distributions of measuring the full registers
+    double total_variation;
+};
+
+template <typename Amplitude, typename OtherAmplitude>
+PrecisionComparison compare_registers(const BasicNativeRegister<Amplitude>& reg, const BasicNativeRegister<OtherAmplitude>& other) {
+    if(reg.getWidth() != other.getWidth())
+        throw std::runtime_error("Compared registers differ in width");
+    PrecisionComparison comparison = {0, 0};
+    for(size_t state = 0; state < (size_t(1) << reg.getWidth()); ++state) {
+        std::complex<double> amplitude = reg.amplitude(state);
+        std::complex<double> other_amplitude = other.amplitude(state);
+        comparison.max_amplitude_error = std::max(comparison.max_amplitude_error, std::abs(amplitude - other_amplitude));
+        comparison.total_variation += std::abs(reg.probability(state) - other.probability(state)) / 2;
+    }
+    return comparison;
+}
+
+#endif
@@ -0,0 +1,405 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_OPTIONS
+#define QUANTUM_CRYPTO_ATTACK_OPTIONS
+
+//Command line options of the experiment driver
+//Every option taking a list or range contributes one dimension to the sweep, the driver runs the Cartesian product of all dimensions
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include "checkpoint.hpp"
+#include "detect.hpp"
+#include "dispatch.hpp"
+#include "qasm.hpp"
+#include "report.hpp"
+#include "sink.hpp"
+
+//Experiment to run at a sweep point
+enum class ExperimentMode {
+    //Self-test of Simon's algorithm on a 3-bit function with a known secret string
+    SimonTest,
+    //Self-test of the classical feistel encryption and decryption routines
+    ClassicTest,
+    //Feistel detection on feistel networks
+    Feistel,
+    //Feistel detection on random permutations
+    Random,
+    //Feistel detection on both, alternating between feistel networks and random permutations
+    Both,
+    //Resource estimation of the detection circuit, counting gates instead of simulating them
+    Estimate,
+    //Export of the circuit of a query of the detection to OpenQASM
+    Qasm,
+    //Detection with the circuit of its queries imported from OpenQASM
+    Import,
+    //Comparison of the single and double precision native backends on a query of the detection
+    Precision
+};
+
+inline const char* mode_name(ExperimentMode mode) {
+    switch(mode) {
+        case ExperimentMode::SimonTest:
+            return "simon";
+        case ExperimentMode::ClassicTest:
+            return "classic";
+        case ExperimentMode::Feistel:
+            return "feistel";
+        case ExperimentMode::Random:
+            return "random";
+        case ExperimentMode::Both:
+            return "both";
+        case ExperimentMode::Estimate:
+            return "estimate";
+        case ExperimentMode::Qasm:
+            return "qasm";
+        case ExperimentMode::Import:
+            return "import";
+        case ExperimentMode::Precision:
+            return "precision";
+    }
+    return "unknown";
+}
+
+struct ExperimentOptions {
+    std::vector<ExperimentMode> modes;
+    std::vector<Backend> backends;
+    std::vector<size_t> bits;
+    std::vector<size_t> rounds;
+    //Width of the S-boxes of the round function, 0 for a single S-box over the full half block
+    size_t sbox_width;
+    OracleKind oracle;
+    ToffoliDecomposition decomposition;
+    //Whether oracles are recorded into an optimised circuit once, and replayed for every query
+    bool cache_circuits;
+    //Path prefix of the OpenQASM files written by the qasm mode, and their version
+    std::string qasm_prefix;
+    QasmVersion qasm_version;
+    //OpenQASM file of the circuit of a query run by the import mode
+    std::string import_file;
+    //Number of trials for every kind of function at every sweep point
+    size_t trials;
+    //Number of worker threads, 0 selects the number of hardware threads
+    size_t threads;
+    uint64_t seed;
+    //Directory of the table cache, empty when functions are not tabulated
+    std::string table_dir;
+    //Largest number of bytes the table files of a run may take up in the table directory
+    uint64_t table_limit;
+    //File receiving a record of every trial, empty when records are not written
+    std::string output;
+    SinkFormat format;
+    //Checkpoint file of the run, empty when no checkpoints are taken
+    std::string checkpoint;
+    //Print the result of every trial, instead of only the summary of every sweep point
+    bool verbose;
+};
+
+//Largest number of rounds accepted by --rounds, far more than a distinguisher experiment needs
+constexpr size_t MAX_FEISTEL_ROUNDS = 64;
+
+//Default limit of the size of the table files of a run, see --table-limit
+constexpr uint64_t DEFAULT_TABLE_LIMIT = 1ull << 30;
+
+const char* const EXPERIMENT_USAGE =
+    "Usage: qa_distinguish [options]\n"
+    "  -m, --mode LIST        simon, classic, feistel, random, both, estimate, qasm, import or precision (default both)\n"
+    "  -b, --backend LIST     libquantum, native, native32, sparse, qmdd, sharded or sampler (default libquantum)\n"
+    "  -w, --bits RANGE       half block sizes of the attacked functions (default 8)\n"
+    "  -r, --rounds RANGE     rounds of the feistel networks, at most 64 (default 3)\n"
+    "  -S, --sbox-width N     width of the S-boxes of the round function, 0 for the full half block\n"
+    "                         (default 0, or 4 with --oracle feistel to keep its gate count polynomial)\n"
+    "  -O, --oracle ORACLE    table or feistel, how the circuits build the oracle of feistel networks (default table)\n"
+    "  -T, --decompose MODE   none, dirty or clean, decompose toffoli gates with more than two controls over borrowed\n"
+    "                         or clean ancillas (default none)\n"
+    "  -C, --circuit-cache    record every oracle once into an optimised circuit, and replay it for every query\n"
+    "  -Q, --qasm PREFIX      path prefix of the OpenQASM files written by the qasm mode (default simon)\n"
+    "  -V, --qasm-version N   2 or 3, the OpenQASM version written by the qasm mode (default 3)\n"
+    "  -I, --import FILE      OpenQASM file with the circuit of a query, run by the import mode\n"
+    "  -n, --trials N         trials per kind of function and sweep point (default 1)\n"
+    "  -j, --threads N        worker threads, 0 for all hardware threads (default 0)\n"
+    "                         libquantum and sharded queries run on one thread at a time\n"
+    "  -s, --seed N           experiment seed, runs with equal seeds are identical (default random)\n"
+    "  -d, --table-dir DIR    tabulate the f functions of the detections into memory-mapped table files in DIR\n"
+    "                         one file of 2^(n+1) elements per trial, only reused by runs with the same seed\n"
+    "  -L, --table-limit N    largest number of bytes the table files of a run may take up (default 1073741824)\n"
+    "  -o, --output FILE      write a record of every trial to FILE, ordered by sweep point and trial id\n"
+    "  -f, --format FORMAT    jsonl or csv, the format of the records written by --output (default jsonl)\n"
+    "  -c, --checkpoint FILE  save finished trials to FILE periodically, and skip the trials already in FILE\n"
+    "  -v, --verbose          print the result of every trial\n"
+    "  -h, --help             print this message\n"
+    "LIST is a comma-separated list of names, RANGE a comma-separated list of values and inclusive ranges first-last[:step], e.g. 2-8:2,12\n";
+
+//Splits a comma-separated list into its items
+inline std::vector<std::string> split_list(const std::string& list) {
+    std::vector<std::string> items;
+    size_t begin = 0;
+    while(true) {
+        size_t end = list.find(',', begin);
+        items.push_back(list.substr(begin, end - begin));
+        if(end == std::string::npos)
+            return items;
+        begin = end + 1;
+    }
+}
+
+//Parses a non-negative integer, rejecting trailing characters
+inline size_t parse_number(const std::string& text) {
+    size_t parsed = 0;
+    unsigned long long value = 0;
+    try {
+        value = std::stoull(text, &parsed);
+    }
+    catch(const std::logic_error& e) {
+        parsed = 0;
+    }
+    if(parsed == 0 || parsed != text.size() || text[0] == '-')
+        throw std::invalid_argument("Invalid number: '" + text + "'");
+    return value;
+}
+
+//Parses a RANGE argument, see EXPERIMENT_USAGE
+//Values above max are rejected before a range is expanded, so a range cannot grow the list without bound, name describes the values in errors
+inline std::vector<size_t> parse_range(const std::string& range, const std::string& name, size_t max) {
+    std::vector<size_t> values;
+    for(const std::string& item : split_list(range)) {
+        size_t dash = item.find('-');
+        if(dash == std::string::npos) {
+            values.push_back(parse_number(item));
+            if(values.back() > max)
+                throw std::invalid_argument("Invalid " + name + ": '" + item + "', at most " + std::to_string(max) + " are supported");
+            continue;
+        }
+
+        size_t colon = item.find(':', dash);
+        size_t first = parse_number(item.substr(0, dash));
+        size_t last = parse_number(item.substr(dash + 1, colon == std::string::npos ? std::string::npos : colon - dash - 1));
+        size_t step = colon == std::string::npos ? 1 : parse_number(item.substr(colon + 1));
+        if(step == 0 || last < first)
+            throw std::invalid_argument("Invalid range: '" + item + "'");
+        if(last > max)
+            throw std::invalid_argument("Invalid " + name + ": '" + item + "', at most " + std::to_string(max) + " are supported");
+        //Stops before value + step passes last, so the value never wraps around
+        for(size_t value = first;; value += step) {
+            values.push_back(value);
+            if(last - value < step)
+                break;
+        }
+    }
+    return values;
+}
+
+//Parses a RANGE argument whose values all have to be in [1, max], such as the bits and rounds of the attacked functions
+inline std::vector<size_t> parse_positive_range(const std::string& range, const std::string& name, size_t max) {
+    std::vector<size_t> values = parse_range(range, name, max);
+    if(std::find(values.begin(), values.end(), size_t(0)) != values.end())
+        throw std::invalid_argument("Invalid " + name + ": '" + range + "', values have to be at least 1");
+    return values;
+}
+
+inline Backend parse_backend(const std::string& name) {
+    for(Backend backend : {Backend::LibQuantum, Backend::Native, Backend::Native32, Backend::Sparse, Backend::Qmdd, Backend::Sharded, Backend::Sampler})
+        if(name == backend_name(backend))
+            return backend;
+    throw std::invalid_argument("Unknown backend: '" + name + "'");
+}
+
+inline OracleKind parse_oracle(const std::string& name) {
+    for(OracleKind oracle : {OracleKind::Table, OracleKind::Feistel})
+        if(name == oracle_name(oracle))
+            return oracle;
+    throw std::invalid_argument("Unknown oracle: '" + name + "'");
+}
+
+inline QasmVersion parse_qasm_version(const std::string& name) {
+    if(name == "2")
+        return QasmVersion::V2;
+    if(name == "3")
+        return QasmVersion::V3;
+    throw std::invalid_argument("Unknown OpenQASM version: '" + name + "'");
+}
+
+inline ToffoliDecomposition parse_decomposition(const std::string& name) {
+    for(ToffoliDecomposition decomposition : {ToffoliDecomposition::None, ToffoliDecomposition::Dirty, ToffoliDecomposition::Clean})
+        if(name == decomposition_name(decomposition))
+            return decomposition;
+    throw std::invalid_argument("Unknown decomposition: '" + name + "'");
+}
+
+inline SinkFormat parse_format(const std::string& name) {
+    if(name == "jsonl")
+        return SinkFormat::Jsonl;
+    if(name == "csv")
+        return SinkFormat::Csv;
+    throw std::invalid_argument("Unknown format: '" + name + "'");
+}
+
+inline ExperimentMode parse_mode(const std::string& name) {
+    for(ExperimentMode mode : {ExperimentMode::SimonTest, ExperimentMode::ClassicTest, ExperimentMode::Feistel, ExperimentMode::Random, ExperimentMode::Both, ExperimentMode::Estimate,
+            ExperimentMode::Qasm, ExperimentMode::Import, ExperimentMode::Precision})
+        if(name == mode_name(mode))
+            return mode;
+    throw std::invalid_argument("Unknown mode: '" + name + "'");
+}
+
+//Fingerprint of the options determining the trials of a run and their results, see Checkpoint
+inline uint64_t experiment_fingerprint(const ExperimentOptions& options) {
+    CheckpointFingerprint fingerprint;
+    fingerprint.add(options.seed).add(options.trials);
+    fingerprint.add(options.modes.size());
+    for(ExperimentMode mode : options.modes)
+        fingerprint.add(static_cast<uint64_t>(mode));
+    fingerprint.add(options.backends.size());
+    for(Backend backend : options.backends)
+        fingerprint.add(static_cast<uint64_t>(backend));
+    fingerprint.add(options.bits.size());
+    for(size_t bits : options.bits)
+        fingerprint.add(bits);
+    fingerprint.add(options.rounds.size());
+    for(size_t rounds : options.rounds)
+        fingerprint.add(rounds);
+    fingerprint.add(options.sbox_width).add(static_cast<uint64_t>(options.oracle)).add(static_cast<uint64_t>(options.decomposition));
+    return fingerprint.get();
+}
+
+//Parses the command line, throws std::invalid_argument with a description of the first invalid option
+//Returns false when only the usage was requested
+inline bool parse_options(int argc, char** argv, ExperimentOptions& options) {
+    options.modes = {ExperimentMode::Both};
+    options.backends = {Backend::LibQuantum};
+    options.bits = {8};
+    options.rounds = {3};
+    options.sbox_width = 0;
+    options.oracle = OracleKind::Table;
+    options.decomposition = ToffoliDecomposition::None;
+    options.cache_circuits = false;
+    options.qasm_prefix = "simon";
+    options.qasm_version = QasmVersion::V3;
+    options.import_file.clear();
+    options.trials = 1;
+    options.threads = 0;
+    options.seed = (uint64_t(std::random_device()()) << 32) ^ std::random_device()();
+    options.table_dir.clear();
+    options.table_limit = DEFAULT_TABLE_LIMIT;
+    options.output.clear();
+    options.format = SinkFormat::Jsonl;
+    options.checkpoint.clear();
+    options.verbose = false;
+
+    const option long_options[] = {
+        {"mode", required_argument, nullptr, 'm'},
+        {"backend", required_argument, nullptr, 'b'},
+        {"bits", required_argument, nullptr, 'w'},
+        {"rounds", required_argument, nullptr, 'r'},
+        {"sbox-width", required_argument, nullptr, 'S'},
+        {"oracle", required_argument, nullptr, 'O'},
+        {"decompose", required_argument, nullptr, 'T'},
+        {"circuit-cache", no_argument, nullptr, 'C'},
+        {"qasm", required_argument, nullptr, 'Q'},
+        {"qasm-version", required_argument, nullptr, 'V'},
+        {"import", required_argument, nullptr, 'I'},
+        {"trials", required_argument, nullptr, 'n'},
+        {"threads", required_argument, nullptr, 'j'},
+        {"seed", required_argument, nullptr, 's'},
+        {"table-dir", required_argument, nullptr, 'd'},
+        {"table-limit", required_argument, nullptr, 'L'},
+        {"output", required_argument, nullptr, 'o'},
+        {"format", required_argument, nullptr, 'f'},
+        {"checkpoint", required_argument, nullptr, 'c'},
+        {"verbose", no_argument, nullptr, 'v'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    //The default S-box width depends on the oracle, which may be given after -S
+    bool sbox_width_given = false;
+    int option;
+    opterr = 0;
+    while((option = getopt_long(argc, argv, "m:b:w:r:S:O:T:CQ:V:I:n:j:s:d:L:o:f:c:vh", long_options, nullptr)) != -1) {
+        switch(option) {
+            case 'm':
+                options.modes.clear();
+                for(const std::string& name : split_list(optarg))
+                    options.modes.push_back(parse_mode(name));
+                break;
+            case 'b':
+                options.backends.clear();
+                for(const std::string& name : split_list(optarg))
+                    options.backends.push_back(parse_backend(name));
+                break;
+            case 'w':
+                options.bits = parse_positive_range(optarg, "bits", QA_MAX_ESTIMATE_BITS);
+                break;
+            case 'r':
+                options.rounds = parse_positive_range(optarg, "rounds", MAX_FEISTEL_ROUNDS);
+                break;
+            case 'S':
+                options.sbox_width = parse_number(optarg);
+                sbox_width_given = true;
+                break;
+            case 'O':
+                options.oracle = parse_oracle(optarg);
+                break;
+            case 'T':
+                options.decomposition = parse_decomposition(optarg);
+                break;
+            case 'C':
+                options.cache_circuits = true;
+                break;
+            case 'Q':
+                options.qasm_prefix = optarg;
+                break;
+            case 'V':
+                options.qasm_version = parse_qasm_version(optarg);
+                break;
+            case 'I':
+                options.import_file = optarg;
+                break;
+            case 'n':
+                options.trials = parse_number(optarg);
+                break;
+            case 'j':
+                options.threads = parse_number(optarg);
+                break;
+            case 's':
+                options.seed = parse_number(optarg);
+                break;
+            case 'd':
+                options.table_dir = optarg;
+                break;
+            case 'L':
+                options.table_limit = parse_number(optarg);
+                break;
+            case 'o':
+                options.output = optarg;
+                break;
+            case 'f':
+                options.format = parse_format(optarg);
+                break;
+            case 'c':
+                options.checkpoint = optarg;
+                break;
+            case 'v':
+                options.verbose = true;
+                break;
+            case 'h':
+                return false;
+            default:
+                throw std::invalid_argument(std::string("Invalid option: ") + argv[optind - 1]);
+        }
+    }
+    if(optind < argc)
+        throw std::invalid_argument(std::string("Unexpected argument: ") + argv[optind]);
+    if(!sbox_width_given && options.oracle == OracleKind::Feistel)
+        options.sbox_width = FEISTEL_ORACLE_DEFAULT_SBOX_WIDTH;
+    if(std::find(options.backends.begin(), options.backends.end(), Backend::Sharded) != options.backends.end())
+        shard_count();
+    return true;
+}
+
+#endif
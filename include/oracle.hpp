@@ -0,0 +1,61 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_ORACLE
+#define QUANTUM_CRYPTO_ATTACK_ORACLE
+
+//Construction of quantum bitflip oracles from classical functions
+
+#include "instrument.hpp"
+#include "register.hpp"
+#include "toffoli.hpp"
+
+//Creates a quantum gate that toggles a given target bit if bits [offset, offset+N) match value
+template <size_t N, typename Reg>
+void create_toggle_if_match(size_t value, Reg* x, size_t target, size_t offset) {
+    //Flip all bits that are 0 in the orignal value
+    //This would cause the register to contain all ones if and only if the value in the register equals value
+    for(size_t i = 0; i < N; ++i) {
+        if(!(value & (1ull << i))) {
+            apply_sigma_x(x, offset + i);
+        }
+    }
+
+    //Use an n-bit toffoli on all N bits, setting the target bit if they are all one
+    //The mask is known at compile time, which avoids instantiating the 2^N entry lookup table of create_masked_toffoli_runtime
+    create_masked_toffoli<N, (1ull << N) - 1>(x, target, offset);
+
+    //Cleanup the flipped bits
+    for(size_t i = 0; i < N; ++i) {
+        if(!(value & (1ull << i))) {
+            apply_sigma_x(x, offset + i);
+        }
+    }
+}
+
+//Convert a classical function into a bitflip oracle
+template <size_t N, size_t M, typename Reg, typename T>
+void bitflip_oracle(Reg* x_y, T function) {
+    //Evaluate all possible inputs to the function, and calculate their results
+    size_t num_posibilities = (1ull << N);
+    for(size_t i = 0; i < num_posibilities; ++i) {
+        //Calculate the input to the i-th possible input to the function
+        size_t result = function(i);
+        QA_COUNT(OracleEvaluations, 1);
+        
+        //For every bit which equals 1 in the output, flip it if and only if the value in the quantum register matches the input i to the function
+        for(size_t j = 0; j < M; ++j) {
+            if(result & (1ull << j))
+                create_toggle_if_match<N>(i, x_y, j+N, 0);
+        }
+    }
+}
+
+//Utility function to create a new function f(register)
+//This function f(register) performs a quantum bitflip oracle matching the classical callback function given as a parameter, on any register type
+template <size_t N, size_t M, typename T>
+auto bind_to_bitflip_oracle(T callback) {
+    return [callback](auto* x_y) {
+        bitflip_oracle<N, M>(x_y, callback);
+    };
+}
+
+#endif
+
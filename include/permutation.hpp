@@ -0,0 +1,104 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_PERMUTATION
+#define QUANTUM_CRYPTO_ATTACK_PERMUTATION
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#include "random.hpp"
+
+//Scrambles a 64-bit value (splitmix64 finalizer), used to expand a single seed into a set of round constants
+inline uint64_t mix_seed(uint64_t value) {
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+//Keyed pseudo-random permutation of the integers in [0, domain), evaluated on demand instead of stored as a lookup table
+//Every round is a bijection modulo 2^width (key addition, xorshift and multiplication by an odd constant), so the round sequence is a bijection as well
+//Domains which are not a power of two are handled by cycle walking: the permutation is reapplied until the value falls inside the domain
+class RandomPermutation {
+    private:
+        static constexpr size_t ROUNDS = 6;
+
+        //Size of the domain, and the number of bits needed to represent it
+        size_t domain;
+        size_t width;
+        size_t mask;
+        //Shift distance of the xorshift step, about half the width so the high bits feed back into the low bits
+        size_t shift;
+        //Per-round constants derived from the seed
+        std::array<size_t, ROUNDS> round_keys;
+        std::array<size_t, ROUNDS> multipliers;
+
+        //Applies the rounds once, mapping [0, 2^width) onto itself
+        inline size_t permute(size_t value) const {
+            for(size_t i = 0; i < ROUNDS; ++i) {
+                value = (value + this->round_keys[i]) & this->mask;
+                value ^= value >> this->shift;
+                value = (value * this->multipliers[i]) & this->mask;
+            }
+            return value ^ (value >> this->shift);
+        }
+    public:
+        //Creates a permutation of [0, domain), a domain of 0 denotes the full 64-bit range
+        RandomPermutation(size_t domain, uint64_t seed) : domain(domain), width(0) {
+            while(this->width < 64 && (this->domain == 0 || (1ull << this->width) < this->domain))
+                ++this->width;
+            this->mask = this->width == 64 ? ~0ull : (1ull << this->width) - 1;
+            this->shift = this->width / 2 + 1;
+
+            uint64_t state = seed;
+            for(size_t i = 0; i < ROUNDS; ++i) {
+                state = mix_seed(state);
+                this->round_keys[i] = state & this->mask;
+                state = mix_seed(state);
+                this->multipliers[i] = (state | 1) & this->mask;
+            }
+        }
+
+        //Creates a permutation of all values of the given number of bits
+        static RandomPermutation ofWidth(size_t width, uint64_t seed) {
+            return RandomPermutation(width == 64 ? 0 : 1ull << width, seed);
+        }
+
+        inline size_t getDomain() const {
+            return this->domain;
+        }
+
+        inline size_t getWidth() const {
+            return this->width;
+        }
+
+        //Evaluates the permutation for an input in [0, domain)
+        inline size_t operator()(size_t input) const {
+            size_t value = this->permute(input & this->mask);
+            if(this->domain != 0)
+                while(value >= this->domain)
+                    value = this->permute(value);
+            return value;
+        }
+};
+
+//Generates a random permutation of integer values
+//This creates a lookup table where every integer between 0 and max appears once, at a random position in the table
+inline size_t* generate_permuation_map(size_t max, size_t permutations, RandomStream& rng) {
+    size_t* permutation_map = new size_t[max];
+    for(size_t i = 0; i < max; ++i) {
+        permutation_map[i] = i;
+    }
+
+    //Swap random elements
+    for(size_t i = 0; i < permutations; ++i) {
+        size_t x = rng.uniform(max);
+        size_t y = rng.uniform(max);
+
+        std::swap(permutation_map[x], permutation_map[y]);
+    }
+
+    return permutation_map;
+}
+
+#endif
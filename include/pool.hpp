@@ -0,0 +1,136 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_POOL
+#define QUANTUM_CRYPTO_ATTACK_POOL
+
+//Work-stealing thread pool used to run independent trials in parallel
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Thread pool where every worker owns a task queue
+//Workers take tasks from the back of their own queue, and steal from the front of the other queues once their own queue runs empty
+class ThreadPool {
+    public:
+        //Tasks receive the index of the worker running them, which can be used to address per-worker state
+        using Task = std::function<void(size_t)>;
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> threads;
+
+        //Guards the counters below, and is used to sleep while there is no work
+        std::mutex state_mutex;
+        std::condition_variable work_available;
+        std::condition_variable work_done;
+        //Number of tasks sitting in a queue, and the number of tasks not yet finished
+        size_t queued;
+        size_t pending;
+        //Queue that receives the next submitted task
+        size_t next_queue;
+        bool stopping;
+
+        //Takes a task from the own queue, or steals one from another queue
+        bool take(size_t index, Task& task) {
+            {
+                Queue& own = *this->queues[index];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if(!own.tasks.empty()) {
+                    task = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    return true;
+                }
+            }
+            for(size_t i = 1; i < this->queues.size(); ++i) {
+                Queue& victim = *this->queues[(index + i) % this->queues.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if(!victim.tasks.empty()) {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void run(size_t index) {
+            Task task;
+            while(true) {
+                {
+                    std::unique_lock<std::mutex> lock(this->state_mutex);
+                    this->work_available.wait(lock, [this] { return this->queued > 0 || this->stopping; });
+                    if(this->queued == 0)
+                        return;
+                    --this->queued;
+                }
+
+                //A task was reserved above, so one of the queues is guaranteed to hold it
+                while(!this->take(index, task))
+                    std::this_thread::yield();
+                task(index);
+
+                std::lock_guard<std::mutex> lock(this->state_mutex);
+                if(--this->pending == 0)
+                    this->work_done.notify_all();
+            }
+        }
+    public:
+        //Creates a pool with the given number of worker threads, 0 selects the number of hardware threads
+        explicit ThreadPool(size_t threads) : queued(0), pending(0), next_queue(0), stopping(false) {
+            if(threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+
+            for(size_t i = 0; i < threads; ++i)
+                this->queues.emplace_back(new Queue());
+            for(size_t i = 0; i < threads; ++i)
+                this->threads.emplace_back(&ThreadPool::run, this, i);
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(this->state_mutex);
+                this->stopping = true;
+            }
+            this->work_available.notify_all();
+            for(std::thread& thread : this->threads)
+                thread.join();
+        }
+
+        inline size_t size() const {
+            return this->threads.size();
+        }
+
+        //Adds a task, tasks are distributed over the worker queues in a round-robin fashion
+        void submit(Task task) {
+            std::lock_guard<std::mutex> state_lock(this->state_mutex);
+            Queue& queue = *this->queues[this->next_queue];
+            this->next_queue = (this->next_queue + 1) % this->queues.size();
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(std::move(task));
+            }
+            ++this->queued;
+            ++this->pending;
+            this->work_available.notify_one();
+        }
+
+        //Blocks until all submitted tasks have finished
+        void wait() {
+            std::unique_lock<std::mutex> lock(this->state_mutex);
+            this->work_done.wait(lock, [this] { return this->pending == 0; });
+        }
+};
+
+#endif
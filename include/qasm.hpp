@@ -0,0 +1,348 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_QASM
+#define QUANTUM_CRYPTO_ATTACK_QASM
+
+//OpenQASM 2 and 3 serialisation of circuits
+//QasmWriter implements the register interface of register.hpp and writes every gate as soon as it is applied, so circuits of any size
+//are exported without holding them in memory. Toffoli gates with more than two controls are written as ctrl(n) @ x in OpenQASM 3. OpenQASM 2 gates
+//have a fixed number of operands and qelib1.inc only defines c3x and c4x, so larger gates are decomposed into ccx gates over borrowed qubits there.
+//All of them can be decomposed into ccx gates by writing through a DecomposingRegister, see decompose.hpp.
+//read_qasm parses the same subset of OpenQASM back into a Circuit, so circuits optimised by other tools can be replayed by our backends
+
+#include <algorithm>
+#include <cctype>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "circuit.hpp"
+#include "decompose.hpp"
+#include "random.hpp"
+#include "simon.hpp"
+
+enum class QasmVersion {
+    V2,
+    V3
+};
+
+//Register writing every gate applied to it as an OpenQASM statement, on a single quantum register q
+class QasmWriter {
+    private:
+        std::ostream& out;
+        size_t width;
+        QasmVersion version;
+
+        void writeOperands(uint64_t controls, uint64_t negated, size_t target) {
+            for(uint64_t remaining = controls; remaining != 0; remaining &= remaining - 1)
+                this->out << " q[" << __builtin_ctzll(remaining) << "],";
+            for(uint64_t remaining = negated; remaining != 0; remaining &= remaining - 1)
+                this->out << " q[" << __builtin_ctzll(remaining) << "],";
+            this->out << " q[" << target << "];\n";
+        }
+    public:
+        //Writes the header and the declarations of the quantum register and of the classical register
+        QasmWriter(std::ostream& out, size_t width, QasmVersion version) : out(out), width(width), version(version) {
+            if(version == QasmVersion::V2)
+                this->out << "OPENQASM 2.0;\ninclude \"qelib1.inc\";\nqreg q[" << width << "];\ncreg c[" << width << "];\n";
+            else
+                this->out << "OPENQASM 3.0;\ninclude \"stdgates.inc\";\nqubit[" << width << "] q;\nbit[" << width << "] c;\n";
+        }
+
+        void hadamard(size_t target) {
+            this->out << "h q[" << target << "];\n";
+        }
+
+        void sigmaX(size_t target) {
+            this->out << "x q[" << target << "];\n";
+        }
+
+        void toffoli(const size_t* controls, size_t count, size_t target) {
+            if(this->version == QasmVersion::V2 && count > 4) {
+                DecomposingRegister<QasmWriter>(this, ToffoliDecomposition::Dirty, this->width, 0).toffoli(controls, count, target);
+                return;
+            }
+
+            if(count == 0)
+                this->out << "x";
+            else if(count == 1)
+                this->out << "cx";
+            else if(count == 2)
+                this->out << "ccx";
+            else if(this->version == QasmVersion::V2)
+                this->out << "c" << count << "x";
+            else
+                this->out << "ctrl(" << count << ") @ x";
+            for(size_t i = 0; i < count; ++i)
+                this->out << " q[" << controls[i] << "],";
+            this->out << " q[" << target << "];\n";
+        }
+
+        //Writes an X gate with positive and negated controls, which only OpenQASM 3 has
+        void toffoliNegated(uint64_t mask, uint64_t negated, size_t target) {
+            if(mask != 0)
+                this->out << "ctrl(" << __builtin_popcountll(mask) << ") @ ";
+            this->out << "negctrl(" << __builtin_popcountll(negated) << ") @ x";
+            this->writeOperands(mask, negated, target);
+        }
+
+        //Measures the first count qubits into the classical register
+        void measure(size_t count) {
+            for(size_t i = 0; i < count; ++i) {
+                if(this->version == QasmVersion::V2)
+                    this->out << "measure q[" << i << "] -> c[" << i << "];\n";
+                else
+                    this->out << "c[" << i << "] = measure q[" << i << "];\n";
+            }
+        }
+
+        inline QasmVersion getVersion() const {
+            return this->version;
+        }
+
+        inline size_t getWidth() const {
+            return this->width;
+        }
+};
+
+//Negated controls of recorded circuits are kept in OpenQASM 3, and conjugated with X gates in OpenQASM 2
+inline void apply_gate(QasmWriter* writer, const Gate& gate) {
+    if(gate.kind == GateKind::X && gate.negated != 0 && writer->getVersion() == QasmVersion::V3)
+        writer->toffoliNegated(gate.mask, gate.negated, gate.target);
+    else
+        apply_gate<QasmWriter>(writer, gate);
+}
+
+//Writes the circuit of one query of Simon's algorithm with N input qubits, M output qubits and the ancillas of the oracle, measuring the input qubits
+template <size_t N, size_t M, typename Oracle>
+void write_simon_qasm(std::ostream& out, Oracle oracle, QasmVersion version) {
+    QasmWriter writer(out, N + M + oracle_ancillas(oracle), version);
+    run_simon_circuit<N>(&writer, oracle);
+    writer.measure(N);
+    if(!out)
+        throw std::runtime_error("Could not write OpenQASM circuit");
+}
+
+//Parser of the subset of OpenQASM 2 and 3 written by QasmWriter, and of swap, c3x and c4x
+//Gate definitions, declarations of classical registers, measurements and barriers are skipped, gates are applied by their standard names, all quantum registers are concatenated in the order of their declaration
+class QasmReader {
+    private:
+        std::istream& in;
+        //Line of the end of the statement being parsed, for error messages
+        size_t line;
+        //First qubit and number of qubits of every quantum register
+        std::map<std::string, std::pair<size_t, size_t>> registers;
+        Circuit circuit;
+
+        [[noreturn]] void fail(const std::string& message) const {
+            throw std::runtime_error("OpenQASM line " + std::to_string(this->line) + ": " + message);
+        }
+
+        //Reads the next statement up to its semicolon, without comments, returns false at the end of the input
+        //The body of a gate definition ends its statement, so definitions are read as a single statement
+        bool next(std::string& statement) {
+            statement.clear();
+            char c;
+            while(this->in.get(c)) {
+                if(c == ';')
+                    return true;
+                if(c == '\n')
+                    ++this->line;
+                if(c == '{') {
+                    while(this->in.get(c) && c != '}')
+                        this->line += c == '\n';
+                    return true;
+                }
+                if(c == '/' && this->in.peek() == '/') {
+                    std::string comment;
+                    std::getline(this->in, comment);
+                    ++this->line;
+                    c = ' ';
+                }
+                statement += c;
+            }
+            if(statement.find_first_not_of(" \t\r\n") != std::string::npos)
+                this->fail("Missing semicolon at the end of the input");
+            return false;
+        }
+
+        //Adds a quantum register of the given number of qubits
+        void declare(const std::string& name, size_t width) {
+            if(this->registers.count(name))
+                this->fail("Register '" + name + "' declared twice");
+            this->registers[name] = {this->circuit.width, width};
+            this->circuit.width += width;
+            if(this->circuit.width > CIRCUIT_MAX_QUBITS)
+                this->fail("Circuits are limited to " + std::to_string(CIRCUIT_MAX_QUBITS) + " qubits");
+        }
+
+        //Parses a qubit operand name[index]
+        size_t qubit(const std::string& operand) const {
+            size_t open = operand.find('[');
+            size_t close = operand.find(']');
+            if(open == std::string::npos || close == std::string::npos || close < open)
+                this->fail("Expected a single qubit, got '" + operand + "'");
+            auto found = this->registers.find(operand.substr(0, open));
+            if(found == this->registers.end())
+                this->fail("Unknown register in '" + operand + "'");
+            size_t index = std::stoull(operand.substr(open + 1, close - open - 1));
+            if(index >= found->second.second)
+                this->fail("Qubit '" + operand + "' outside of its register");
+            return found->second.first + index;
+        }
+
+        //Parses the qubit operands of a gate, separated by commas
+        std::vector<size_t> operands(const std::string& text) const {
+            std::vector<size_t> qubits;
+            std::stringstream stream(text);
+            std::string operand;
+            while(std::getline(stream, operand, ',')) {
+                operand.erase(std::remove_if(operand.begin(), operand.end(), [](unsigned char c) { return std::isspace(c); }), operand.end());
+                qubits.push_back(this->qubit(operand));
+            }
+            return qubits;
+        }
+
+        void addX(uint64_t mask, uint64_t negated, size_t target) {
+            if(((mask | negated) & (1ull << target)) != 0 || (mask & negated) != 0)
+                this->fail("Qubit used twice by a gate");
+            this->circuit.gates.push_back({GateKind::X, uint32_t(target), mask, negated});
+        }
+
+        //Parses a gate application, the gate modifiers ctrl and negctrl are only supported on x
+        void gate(std::string statement) {
+            std::vector<bool> modifiers;
+            while(statement.compare(0, 4, "ctrl") == 0 || statement.compare(0, 7, "negctrl") == 0) {
+                bool negated = statement[0] == 'n';
+                size_t at = statement.find('@');
+                if(at == std::string::npos)
+                    this->fail("Expected @ after a gate modifier");
+                size_t count = 1;
+                size_t open = statement.find('(');
+                if(open < at)
+                    count = std::stoull(statement.substr(open + 1));
+                modifiers.insert(modifiers.end(), count, negated);
+                statement = statement.substr(statement.find_first_not_of(" \t\r\n", at + 1));
+            }
+
+            size_t space = statement.find_first_of(" \t\r\n");
+            if(space == std::string::npos)
+                this->fail("Expected operands of '" + statement + "'");
+            std::string name = statement.substr(0, space);
+            std::vector<size_t> qubits = this->operands(statement.substr(space));
+
+            if(name == "h" && modifiers.empty() && qubits.size() == 1) {
+                this->circuit.gates.push_back({GateKind::HadamardLayer, 0, 1ull << qubits[0], 0});
+                return;
+            }
+            if(name == "swap" && modifiers.empty() && qubits.size() == 2) {
+                this->addX(1ull << qubits[0], 0, qubits[1]);
+                this->addX(1ull << qubits[1], 0, qubits[0]);
+                this->addX(1ull << qubits[0], 0, qubits[1]);
+                return;
+            }
+
+            static const std::map<std::string, size_t> x_gates = {{"x", 0}, {"cx", 1}, {"CX", 1}, {"ccx", 2}, {"c3x", 3}, {"c4x", 4}};
+            auto found = x_gates.find(name);
+            if(found == x_gates.end() && name != "mcx")
+                this->fail("Unsupported gate '" + name + "', only h, swap and controlled x gates are supported");
+            size_t controls = found != x_gates.end() ? found->second : qubits.size() - 1;
+            if(qubits.size() != modifiers.size() + controls + 1)
+                this->fail("Wrong number of operands of '" + name + "'");
+
+            uint64_t mask = 0;
+            uint64_t negated = 0;
+            for(size_t i = 0; i + 1 < qubits.size(); ++i) {
+                uint64_t& polarity = i < modifiers.size() && modifiers[i] ? negated : mask;
+                if(((mask | negated) & (1ull << qubits[i])) != 0)
+                    this->fail("Qubit used twice by a gate");
+                polarity |= 1ull << qubits[i];
+            }
+            this->addX(mask, negated, qubits.back());
+        }
+
+        void statement(const std::string& text) {
+            size_t begin = text.find_first_not_of(" \t\r\n");
+            if(begin == std::string::npos)
+                return;
+            size_t end = text.find_last_not_of(" \t\r\n");
+            std::string statement = text.substr(begin, end - begin + 1);
+            std::string keyword = statement.substr(0, statement.find_first_of(" \t\r\n[("));
+
+            if(keyword == "OPENQASM") {
+                std::string version = statement.substr(keyword.size());
+                version.erase(0, version.find_first_not_of(" \t\r\n"));
+                if(version[0] != '2' && version[0] != '3')
+                    this->fail("Unsupported OpenQASM version " + version);
+            }
+            else if(keyword == "qreg") {
+                size_t open = statement.find('[');
+                std::string name = statement.substr(4, open - 4);
+                name.erase(std::remove_if(name.begin(), name.end(), [](unsigned char c) { return std::isspace(c); }), name.end());
+                this->declare(name, std::stoull(statement.substr(open + 1)));
+            }
+            else if(keyword == "qubit") {
+                size_t open = statement.find('[');
+                size_t close = statement.find(']');
+                size_t width = open == std::string::npos ? 1 : std::stoull(statement.substr(open + 1));
+                std::string name = statement.substr(close == std::string::npos ? keyword.size() : close + 1);
+                name.erase(std::remove_if(name.begin(), name.end(), [](unsigned char c) { return std::isspace(c); }), name.end());
+                this->declare(name, width);
+            }
+            else if(keyword == "gate" || keyword == "opaque" || keyword == "include" || keyword == "creg" || keyword == "bit" || keyword == "barrier" || statement.find("measure") != std::string::npos) {
+                return;
+            }
+            else {
+                this->gate(statement);
+            }
+        }
+    public:
+        explicit QasmReader(std::istream& in) : in(in), line(1), circuit({0, {}}) {}
+
+        //Parses all statements of the input into a circuit, throws std::runtime_error at the first unsupported statement
+        Circuit read() {
+            std::string text;
+            try {
+                while(this->next(text))
+                    this->statement(text);
+            }
+            catch(const std::logic_error&) {
+                this->fail("Invalid statement");
+            }
+            return std::move(this->circuit);
+        }
+};
+
+inline Circuit read_qasm(std::istream& in) {
+    return QasmReader(in).read();
+}
+
+//Number of random basis states on which the export mode compares a written circuit with the recorded one
+constexpr size_t QASM_ROUND_TRIP_STATES = 4096;
+
+//Checks that two circuits of a query of Simon's algorithm with N input qubits and M output qubits have the same oracle, such as a recorded
+//circuit and the circuit read back from its OpenQASM export. The oracles are compared on count random basis states with clean ancillas,
+//which suffices as gates decomposed over borrowed qubits restore them in every basis state
+template <size_t N, size_t M>
+bool simon_oracles_match(const Circuit& expected, const Circuit& actual, RandomStream& rng, size_t count) {
+    if(expected.width != actual.width)
+        return false;
+    CircuitOracle expected_oracle = simon_oracle_of<N, M>(expected);
+    CircuitOracle actual_oracle = simon_oracle_of<N, M>(actual);
+    for(size_t i = 0; i < count; ++i) {
+        //Queries of 64 or more qubits cannot be recorded, see CIRCUIT_MAX_QUBITS, but the comparison is still instantiated for them
+        uint64_t state;
+        if constexpr(N + M < 64)
+            state = rng.uniform(1ull << (N + M));
+        else
+            state = rng();
+        if(evaluate_basis_state(*expected_oracle.circuit, state) != evaluate_basis_state(*actual_oracle.circuit, state))
+            return false;
+    }
+    return true;
+}
+
+#endif
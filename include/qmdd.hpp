@@ -0,0 +1,358 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_QMDD
+#define QUANTUM_CRYPTO_ATTACK_QMDD
+
+//Experimental decision diagram simulator, representing the state vector as a quantum multiple-valued decision diagram (QMDD)
+//Every node splits the state on one qubit, from the highest qubit at the root down to qubit 0, into the half where the qubit is 0 and the
+//half where it is 1. Edges carry weights, and nodes are normalised so that the larger weight of their two edges is 1, which makes equal
+//subvectors up to a factor share a single node. The unique table finds these nodes, and the compute tables cache the results of additions
+//and of the current gate per node, so a gate costs time in the number of nodes rather than in the number of basis states.
+//Structured oracles keep the diagram small, which lets circuits be simulated beyond the memory of a dense state vector.
+//Weights are rounded to a grid of QMDD_WEIGHT_SCALE steps, so numerically equal nodes are recognised as equal
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "native.hpp"
+#include "random.hpp"
+
+//Number of grid steps per unit of the weights of the diagram
+constexpr double QMDD_WEIGHT_SCALE = 1ull << 40;
+
+//Number of nodes after which unreachable nodes are collected, the limit doubles when most nodes are reachable
+constexpr size_t QMDD_COLLECT_NODES = 1 << 16;
+
+inline double qmdd_snap(double weight) {
+    //Adding 0 turns -0 into 0, so equal weights have equal bits
+    return std::round(weight * QMDD_WEIGHT_SCALE) / QMDD_WEIGHT_SCALE + 0.0;
+}
+
+inline std::complex<double> qmdd_snap(std::complex<double> weight) {
+    return {qmdd_snap(weight.real()), qmdd_snap(weight.imag())};
+}
+
+inline size_t qmdd_hash(double weight) {
+    return std::hash<double>()(weight);
+}
+
+inline size_t qmdd_hash(std::complex<double> weight) {
+    return std::hash<double>()(weight.real()) * 31 + std::hash<double>()(weight.imag());
+}
+
+template <typename Amplitude>
+class BasicQmddRegister {
+    private:
+        //Index of the terminal node, the one-element vector 1
+        static constexpr uint32_t TERMINAL = 0;
+
+        struct Edge {
+            uint32_t node;
+            Amplitude weight;
+
+            inline bool operator==(const Edge& other) const {
+                return this->node == other.node && this->weight == other.weight;
+            }
+        };
+
+        struct Node {
+            //Qubit the node splits on
+            uint32_t qubit;
+            Edge low;
+            Edge high;
+
+            inline bool operator==(const Node& other) const {
+                return this->qubit == other.qubit && this->low == other.low && this->high == other.high;
+            }
+        };
+
+        struct NodeHash {
+            size_t operator()(const Node& node) const {
+                size_t hash = node.qubit;
+                hash = hash * 1000003 + node.low.node;
+                hash = hash * 1000003 + qmdd_hash(node.low.weight);
+                hash = hash * 1000003 + node.high.node;
+                hash = hash * 1000003 + qmdd_hash(node.high.weight);
+                return hash;
+            }
+        };
+
+        //Operands of a cached addition, the sum of the node first and the node second scaled by ratio
+        struct AddKey {
+            uint32_t first;
+            uint32_t second;
+            Amplitude ratio;
+
+            inline bool operator==(const AddKey& other) const {
+                return this->first == other.first && this->second == other.second && this->ratio == other.ratio;
+            }
+        };
+
+        struct AddKeyHash {
+            size_t operator()(const AddKey& key) const {
+                return (size_t(key.first) * 1000003 + key.second) * 1000003 + qmdd_hash(key.ratio);
+            }
+        };
+
+        size_t width;
+        Edge root;
+        std::vector<Node> nodes;
+        std::unordered_map<Node, uint32_t, NodeHash> unique;
+        std::unordered_map<AddKey, Edge, AddKeyHash> add_cache;
+        //Results of the current gate per node, cleared before every gate
+        std::unordered_map<uint32_t, Edge> gate_cache;
+        std::unordered_map<uint32_t, Edge> project_cache;
+        size_t collect_limit;
+
+        static Edge zero() {
+            return {TERMINAL, 0};
+        }
+
+        static Edge scale(const Edge& edge, Amplitude factor) {
+            Amplitude weight = edge.weight * factor;
+            return weight == Amplitude(0) ? zero() : Edge{edge.node, weight};
+        }
+
+        //Returns the normalised node with the given edges, scaled by the factor pulled out of them
+        Edge makeNode(uint32_t qubit, Edge low, Edge high) {
+            low.weight = qmdd_snap(low.weight);
+            high.weight = qmdd_snap(high.weight);
+            if(low.weight == Amplitude(0) && high.weight == Amplitude(0))
+                return zero();
+            if(low.weight == Amplitude(0))
+                low = zero();
+            if(high.weight == Amplitude(0))
+                high = zero();
+
+            Amplitude factor = std::abs(low.weight) >= std::abs(high.weight) ? low.weight : high.weight;
+            low.weight = qmdd_snap(low.weight / factor);
+            high.weight = qmdd_snap(high.weight / factor);
+            Node node = {qubit, low, high};
+            auto found = this->unique.find(node);
+            if(found != this->unique.end())
+                return {found->second, factor};
+            uint32_t index = this->nodes.size();
+            this->nodes.push_back(node);
+            this->unique.emplace(node, index);
+            return {index, factor};
+        }
+
+        //Sum of two edges at the same level
+        Edge add(const Edge& first, const Edge& second) {
+            if(first.weight == Amplitude(0))
+                return second;
+            if(second.weight == Amplitude(0))
+                return first;
+            if(first.node == second.node)
+                return scale({first.node, 1}, first.weight + second.weight);
+
+            AddKey key = {first.node, second.node, qmdd_snap(second.weight / first.weight)};
+            auto found = this->add_cache.find(key);
+            if(found != this->add_cache.end())
+                return scale(found->second, first.weight);
+
+            const Node first_node = this->nodes[first.node];
+            const Node second_node = this->nodes[second.node];
+            Edge low = this->add(first_node.low, scale(second_node.low, key.ratio));
+            Edge high = this->add(first_node.high, scale(second_node.high, key.ratio));
+            Edge result = this->makeNode(first_node.qubit, low, high);
+            this->add_cache.emplace(key, result);
+            return scale(result, first.weight);
+        }
+
+        //Applies function to the node of edge, caching its result per node for the current gate
+        template <typename Func>
+        Edge applyCached(std::unordered_map<uint32_t, Edge>& cache, const Edge& edge, Func& function) {
+            if(edge.weight == Amplitude(0))
+                return edge;
+            auto found = cache.find(edge.node);
+            if(found != cache.end())
+                return scale(found->second, edge.weight);
+            Edge result = function(edge.node);
+            cache.emplace(edge.node, result);
+            return scale(result, edge.weight);
+        }
+
+        //Keeps the basis states of the node where all bits in control_mask are set and all bits in negated_mask are clear, zeroing the others
+        Edge project(uint32_t index, uint64_t control_mask, uint64_t negated_mask) {
+            if(index == TERMINAL)
+                return {TERMINAL, 1};
+            auto function = [&](uint32_t child) {
+                return this->project(child, control_mask, negated_mask);
+            };
+            const Node node = this->nodes[index];
+            const uint64_t bit = uint64_t(1) << node.qubit;
+            Edge low = (negated_mask & bit) || !(control_mask & bit) ? this->applyCached(this->project_cache, node.low, function) : zero();
+            Edge high = (control_mask & bit) || !(negated_mask & bit) ? this->applyCached(this->project_cache, node.high, function) : zero();
+            return this->makeNode(node.qubit, low, high);
+        }
+
+        Edge toggle(uint32_t index, uint64_t control_mask, size_t target, uint64_t negated_mask) {
+            auto function = [&](uint32_t child) {
+                return this->toggle(child, control_mask, target, negated_mask);
+            };
+            const Node node = this->nodes[index];
+            const uint64_t bit = uint64_t(1) << node.qubit;
+            if(node.qubit > target) {
+                //A control above the target leaves the half where it does not match unchanged
+                Edge low = control_mask & bit ? node.low : this->applyCached(this->gate_cache, node.low, function);
+                Edge high = negated_mask & bit ? node.high : this->applyCached(this->gate_cache, node.high, function);
+                return this->makeNode(node.qubit, low, high);
+            }
+
+            const uint64_t below = bit - 1;
+            if(((control_mask | negated_mask) & below) == 0)
+                return this->makeNode(node.qubit, node.high, node.low);
+            //Exchange the parts of both halves where the controls below the target match
+            auto projection = [&](uint32_t child) {
+                return this->project(child, control_mask & below, negated_mask & below);
+            };
+            Edge low_match = this->applyCached(this->project_cache, node.low, projection);
+            Edge high_match = this->applyCached(this->project_cache, node.high, projection);
+            Edge low = this->add(this->add(node.low, scale(low_match, -1)), high_match);
+            Edge high = this->add(this->add(node.high, scale(high_match, -1)), low_match);
+            return this->makeNode(node.qubit, low, high);
+        }
+
+        Edge hadamard(uint32_t index, size_t target) {
+            auto function = [&](uint32_t child) {
+                return this->hadamard(child, target);
+            };
+            const Node node = this->nodes[index];
+            if(node.qubit > target)
+                return this->makeNode(node.qubit, this->applyCached(this->gate_cache, node.low, function), this->applyCached(this->gate_cache, node.high, function));
+            const double factor = std::sqrt(0.5);
+            Edge low = this->add(node.low, node.high);
+            Edge high = this->add(node.low, scale(node.high, -1));
+            return this->makeNode(node.qubit, scale(low, factor), scale(high, factor));
+        }
+
+        //Copies the nodes reachable from the root into a fresh table, dropping all others and the caches
+        void collect() {
+            std::vector<Node> old_nodes;
+            old_nodes.swap(this->nodes);
+            this->unique.clear();
+            this->add_cache.clear();
+            this->nodes.push_back({0, zero(), zero()});
+            std::unordered_map<uint32_t, uint32_t> moved = {{TERMINAL, TERMINAL}};
+            std::function<uint32_t(uint32_t)> copy = [&](uint32_t index) {
+                auto found = moved.find(index);
+                if(found != moved.end())
+                    return found->second;
+                Node node = old_nodes[index];
+                node.low.node = copy(node.low.node);
+                node.high.node = copy(node.high.node);
+                uint32_t copied = this->nodes.size();
+                this->nodes.push_back(node);
+                this->unique.emplace(node, copied);
+                moved.emplace(index, copied);
+                return copied;
+            };
+            this->root.node = copy(this->root.node);
+            if(this->nodes.size() > this->collect_limit / 2)
+                this->collect_limit *= 2;
+        }
+
+        template <typename Func>
+        void applyGate(Func function) {
+            this->gate_cache.clear();
+            this->project_cache.clear();
+            this->root = this->applyCached(this->gate_cache, this->root, function);
+            if(this->nodes.size() > this->collect_limit)
+                this->collect();
+        }
+
+    public:
+        //Creates a register of width qubits in basis state initial
+        explicit BasicQmddRegister(size_t width, size_t initial = 0) : width(width), collect_limit(QMDD_COLLECT_NODES) {
+            if(width > 64)
+                throw std::runtime_error("Register too wide for the qmdd backend");
+            this->nodes.push_back({0, zero(), zero()});
+            this->root = {TERMINAL, 1};
+            for(size_t qubit = 0; qubit < width; ++qubit) {
+                if(initial & (uint64_t(1) << qubit))
+                    this->root = this->makeNode(qubit, zero(), this->root);
+                else
+                    this->root = this->makeNode(qubit, this->root, zero());
+            }
+        }
+
+        inline size_t getWidth() const {
+            return this->width;
+        }
+
+        //Number of nodes stored, including nodes which are no longer reachable and not yet collected
+        inline size_t nodeCount() const {
+            return this->nodes.size();
+        }
+
+        void hadamard(size_t target) {
+            this->applyGate([&](uint32_t index) {
+                return this->hadamard(index, target);
+            });
+        }
+
+        void sigmaX(size_t target) {
+            this->toffoliMask(0, target);
+        }
+
+        //Toggles target in every basis state where all bits in control_mask are set, and all bits in negated_mask are clear
+        void toffoliMask(uint64_t control_mask, size_t target, uint64_t negated_mask = 0) {
+            this->applyGate([&](uint32_t index) {
+                return this->toggle(index, control_mask, target, negated_mask);
+            });
+        }
+
+        void toffoli(const size_t* controls, size_t count, size_t target) {
+            uint64_t control_mask = 0;
+            for(size_t i = 0; i < count; ++i)
+                control_mask |= uint64_t(1) << controls[i];
+            this->toffoliMask(control_mask, target);
+        }
+
+        //Samples a measurement of the full register, descending from the root with the probability of either half of every node
+        size_t measure(RandomStream& rng) const {
+            //Squared norm of the vector of every node reachable from the root
+            std::unordered_map<uint32_t, double> norms = {{TERMINAL, 1.0}};
+            std::function<double(uint32_t)> norm = [&](uint32_t index) {
+                auto found = norms.find(index);
+                if(found != norms.end())
+                    return found->second;
+                const Node& node = this->nodes[index];
+                double result = 0;
+                if(node.low.weight != Amplitude(0))
+                    result += std::norm(node.low.weight) * norm(node.low.node);
+                if(node.high.weight != Amplitude(0))
+                    result += std::norm(node.high.weight) * norm(node.high.node);
+                norms.emplace(index, result);
+                return result;
+            };
+
+            double sample = rng.uniformReal();
+            size_t state = 0;
+            uint32_t index = this->root.node;
+            while(index != TERMINAL) {
+                const Node& node = this->nodes[index];
+                double low = node.low.weight == Amplitude(0) ? 0 : std::norm(node.low.weight) * norm(node.low.node);
+                double high = node.high.weight == Amplitude(0) ? 0 : std::norm(node.high.weight) * norm(node.high.node);
+                double fraction = low / (low + high);
+                if(sample < fraction) {
+                    sample /= fraction;
+                    index = node.low.node;
+                } else {
+                    sample = (sample - fraction) / (1 - fraction);
+                    state |= uint64_t(1) << node.qubit;
+                    index = node.high.node;
+                }
+            }
+            return state;
+        }
+};
+
+using QmddRegister = BasicQmddRegister<std::complex<double>>;
+using RealQmddRegister = BasicQmddRegister<double>;
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_RANDOM
+#define QUANTUM_CRYPTO_ATTACK_RANDOM
+
+//Counter-based random number generation
+//Every random value is a pure function of (experiment seed, trial id, stream, position), so trials are reproducible
+//independently of each other and can run on any thread without sharing generator state
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+//Identifies the independent random streams used within a single trial
+enum class RandomStreamId : uint32_t {
+    //Cipher keys and permutation seeds
+    Keys = 0,
+    //ALPHA and BETA parameters of the f function
+    Parameters = 1,
+    //The random u used to verify a solved equation
+    Verification = 2,
+    //Measurement sampling of the quantum register
+    Measurement = 3,
+    //Public components of a cipher shared by all trials of an experiment, such as S-boxes, drawn from the streams of trial 0
+    Cipher = 4
+};
+
+//Philox4x32-10 block function, maps a 128-bit counter and 64-bit key to 128 random bits
+inline std::array<uint32_t, 4> philox4x32(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key) {
+    for(size_t round = 0; round < 10; ++round) {
+        uint64_t product_0 = uint64_t(0xd2511f53u) * counter[0];
+        uint64_t product_1 = uint64_t(0xcd9e8d57u) * counter[2];
+
+        counter = {
+            uint32_t(product_1 >> 32) ^ counter[1] ^ key[0],
+            uint32_t(product_1),
+            uint32_t(product_0 >> 32) ^ counter[3] ^ key[1],
+            uint32_t(product_0)
+        };
+
+        key[0] += 0x9e3779b9u;
+        key[1] += 0xbb67ae85u;
+    }
+    return counter;
+}
+
+//Random stream of 64-bit values for a single (experiment seed, trial id, stream) triple
+//Satisfies the UniformRandomBitGenerator requirements, so it can be used with the standard distributions
+class RandomStream {
+    private:
+        std::array<uint32_t, 2> key;
+        uint32_t trial;
+        uint32_t stream;
+        //Number of 64-bit values drawn so far
+        uint64_t position;
+
+    public:
+        using result_type = uint64_t;
+
+        RandomStream(uint64_t seed, uint64_t trial, RandomStreamId stream) :
+            key({uint32_t(seed), uint32_t(seed >> 32)}),
+            trial(uint32_t(trial)),
+            stream(static_cast<uint32_t>(stream) | uint32_t(trial >> 32) << 8),
+            position(0) {}
+
+        static constexpr result_type min() {
+            return 0;
+        }
+
+        static constexpr result_type max() {
+            return std::numeric_limits<result_type>::max();
+        }
+
+        //Draws the next 64-bit value, every Philox block yields two values
+        inline result_type operator()() {
+            uint64_t block = this->position >> 1;
+            std::array<uint32_t, 4> bits = philox4x32({uint32_t(block), uint32_t(block >> 32), this->trial, this->stream}, this->key);
+            size_t half = (this->position++ & 1) * 2;
+            return uint64_t(bits[half]) | uint64_t(bits[half + 1]) << 32;
+        }
+
+        //Draws a uniformly distributed value in [0, bound), without modulo bias
+        inline size_t uniform(size_t bound) {
+            unsigned __int128 product = (unsigned __int128)(*this)() * bound;
+            uint64_t low = uint64_t(product);
+            if(low < bound) {
+                uint64_t threshold = -bound % bound;
+                while(low < threshold) {
+                    product = (unsigned __int128)(*this)() * bound;
+                    low = uint64_t(product);
+                }
+            }
+            return size_t(product >> 64);
+        }
+
+        //Draws a uniformly distributed double in [0, 1)
+        inline double uniformReal() {
+            return ((*this)() >> 11) * 0x1.0p-53;
+        }
+
+        //Position of the stream, the number of values drawn since construction
+        inline uint64_t getPosition() const {
+            return this->position;
+        }
+
+        //Moves the stream to the given position, drawing continues as if position values had been drawn
+        inline void seek(uint64_t position) {
+            this->position = position;
+        }
+};
+
+//Identifies a single trial of an experiment, all random streams of the trial are derived from it
+struct TrialSeed {
+    uint64_t seed;
+    uint64_t trial;
+
+    inline RandomStream stream(RandomStreamId id) const {
+        return RandomStream(this->seed, this->trial, id);
+    }
+};
+
+#endif
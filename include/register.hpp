@@ -0,0 +1,48 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_REGISTER
+#define QUANTUM_CRYPTO_ATTACK_REGISTER
+
+//Gate interface used by the circuit construction helpers in toffoli.hpp, oracle.hpp and simon.hpp
+//Circuits are built against a register pointer, so the same construction runs on every backend.
+//libquantum registers are adapted by the overloads below, our own register types implement the gates as member functions:
+// - hadamard(target) and sigmaX(target)
+// - toffoli(controls, count, target), toggling target if all count qubits in the controls array are set
+// - measure(rng), sampling a measurement of the full register
+// - getWidth(), the number of qubits
+
+#include <cstddef>
+
+#include "instrument.hpp"
+#include "quantum.hpp"
+
+inline void apply_hadamard(quantum_reg* reg, size_t target) {
+    QA_COUNT(HadamardGates, 1);
+    quantum_hadamard(target, reg);
+}
+
+template <typename Reg>
+inline void apply_hadamard(Reg* reg, size_t target) {
+    QA_COUNT(HadamardGates, 1);
+    reg->hadamard(target);
+}
+
+inline void apply_sigma_x(quantum_reg* reg, size_t target) {
+    QA_COUNT(SigmaXGates, 1);
+    quantum_sigma_x(target, reg);
+}
+
+template <typename Reg>
+inline void apply_sigma_x(Reg* reg, size_t target) {
+    QA_COUNT(SigmaXGates, 1);
+    reg->sigmaX(target);
+}
+
+inline size_t register_width(quantum_reg* reg) {
+    return reg->width;
+}
+
+template <typename Reg>
+inline size_t register_width(Reg* reg) {
+    return reg->getWidth();
+}
+
+#endif
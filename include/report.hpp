@@ -0,0 +1,137 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_REPORT
+#define QUANTUM_CRYPTO_ATTACK_REPORT
+
+//Human-readable reporting of detection and trial results
+//Detections and trial runs only return plain results, so drivers running many trials decide themselves when to pay for output
+
+#include <ostream>
+
+#include "circuit.hpp"
+#include "detect.hpp"
+#include "estimate.hpp"
+#include "trials.hpp"
+
+//Short machine-readable name of a backend
+inline const char* backend_name(Backend backend) {
+    switch(backend) {
+        case Backend::LibQuantum:
+            return "libquantum";
+        case Backend::Native:
+            return "native";
+        case Backend::Sampler:
+            return "sampler";
+        case Backend::Native32:
+            return "native32";
+        case Backend::Sparse:
+            return "sparse";
+        case Backend::Qmdd:
+            return "qmdd";
+        case Backend::Sharded:
+            return "sharded";
+    }
+    return "unknown";
+}
+
+//Short machine-readable name of the kind of function of a trial
+inline const char* kind_name(TrialKind kind) {
+    return kind == TrialKind::Feistel ? "feistel" : "random";
+}
+
+//Short machine-readable name of an oracle kind
+inline const char* oracle_name(OracleKind oracle) {
+    return oracle == OracleKind::Feistel ? "feistel" : "table";
+}
+
+//Short machine-readable name of a toffoli decomposition
+inline const char* decomposition_name(ToffoliDecomposition decomposition) {
+    switch(decomposition) {
+        case ToffoliDecomposition::None:
+            return "none";
+        case ToffoliDecomposition::Dirty:
+            return "dirty";
+        case ToffoliDecomposition::Clean:
+            return "clean";
+    }
+    return "unknown";
+}
+
+//Short machine-readable name of a verdict
+inline const char* verdict_name(DetectionVerdict verdict) {
+    switch(verdict) {
+        case DetectionVerdict::SolvedFeistel:
+            return "solved-feistel";
+        case DetectionVerdict::RankDeficientFeistel:
+            return "rank-deficient-feistel";
+        case DetectionVerdict::Random:
+            return "random";
+    }
+    return "unknown";
+}
+
+//Description of a verdict, as reported to the user, without a round count as the attacked networks may have any number of rounds
+inline const char* verdict_description(DetectionVerdict verdict) {
+    switch(verdict) {
+        case DetectionVerdict::SolvedFeistel:
+            return "Feistel network (solved equation)";
+        case DetectionVerdict::RankDeficientFeistel:
+            return "Feistel network (more than 2n equations attempted)";
+        case DetectionVerdict::Random:
+            return "Random permutation";
+    }
+    return "Unknown";
+}
+
+//Prints the verdict of a detection, followed by its statistics when verbose is set
+inline void print_detection_result(std::ostream& out, const DetectionResult& result, bool verbose) {
+    out << verdict_description(result.verdict) << std::endl;
+    if(!verbose)
+        return;
+
+    out << "  s: " << result.s << ", queries: " << result.queries << ", inconsistent equations: " << result.inconsistent << std::endl;
+    out << "  setup " << result.timings.setup << "s, simon " << result.timings.simon << "s, solve " << result.timings.solve
+        << "s, verify " << result.timings.verify << "s" << std::endl;
+}
+
+//Prints the resources of a single run of Simon's algorithm, and of a detection running it at most max_queries times
+inline void print_resource_estimate(std::ostream& out, const ResourceRegister& query, size_t max_queries) {
+    out << "Qubits: " << query.getWidth() << " + " << query.getAncillas() << " ancillas for the toffoli decomposition" << std::endl;
+    out << "Per query: hadamard " << query.getHadamardGates() << ", sigma-x " << query.getSigmaXGates() << ", toffoli " << query.getToffoliGates()
+        << ", T-count " << query.getTCount() << ", depth " << query.getDepth() << std::endl;
+    out << "Toffoli gates by controls:";
+    const std::vector<uint64_t>& controls = query.getToffoliControls();
+    for(size_t i = 0; i < controls.size(); ++i) {
+        if(controls[i] != 0)
+            out << " " << i << ":" << controls[i];
+    }
+    out << std::endl;
+    out << "Detection (at most " << max_queries << " queries): toffoli " << query.getToffoliGates() * max_queries << ", T-count "
+        << query.getTCount() * max_queries << ", depth " << query.getDepth() * max_queries << std::endl;
+}
+
+//Prints the deviation of the single precision native register from the double precision one
+inline void print_precision_comparison(std::ostream& out, const PrecisionComparison& comparison, size_t width) {
+    out << "Single precision on " << width << " qubits: largest amplitude error " << comparison.max_amplitude_error
+        << ", total variation distance of the measurement " << comparison.total_variation << std::endl;
+}
+
+//Prints the size and the depth of a circuit ordered by schedule_circuit
+inline void print_circuit_schedule(std::ostream& out, const Circuit& circuit) {
+    out << "Oracle circuit: " << circuit.gates.size() << " gates in " << circuit.layers.size() << " layers";
+    if(!circuit.layers.empty())
+        out << ", " << double(circuit.gates.size()) / circuit.layers.size() << " gates per layer";
+    out << std::endl;
+}
+
+//Prints the aggregated results of a batch of trials
+inline void print_trial_summary(std::ostream& out, const TrialSummary& summary, size_t threads) {
+    out << "Trials: " << summary.trials() << " on " << threads << " threads" << std::endl;
+    out << "True positive rate: " << summary.truePositiveRate() << " (" << summary.feistel_detected << "/" << summary.feistel_trials << ")" << std::endl;
+    out << "False positive rate: " << summary.falsePositiveRate() << " (" << summary.random_detected << "/" << summary.random_trials << ")" << std::endl;
+    out << "Mean queries: " << summary.meanQueries() << ", inconsistent equations: " << summary.total_inconsistent << std::endl;
+    out << "Time per trial: mean " << summary.meanSeconds() << "s, min " << summary.min_seconds << "s, max " << summary.max_seconds << "s" << std::endl;
+    out << "Time per phase: setup " << summary.total_timings.setup << "s, simon " << summary.total_timings.simon << "s, solve "
+        << summary.total_timings.solve << "s, verify " << summary.total_timings.verify << "s" << std::endl;
+    out << "Wall time: " << summary.wall_seconds << "s" << std::endl;
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_SAMPLER
+#define QUANTUM_CRYPTO_ATTACK_SAMPLER
+
+//Classical sampler for the output distribution of Simon's algorithm
+//Instead of simulating the quantum register, the measurement is drawn directly from the distribution the circuit produces:
+//measuring the second register yields y = f(x0) for a uniformly random x0, after which the first register holds a uniform superposition
+//over the preimage set S of y, and the final Hadamard layer measures z with probability |sum_{x in S} (-1)^(x.z)|^2 / (|S| * 2^N)
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "random.hpp"
+
+//Samples measurements of Simon's algorithm for a fixed function f with N input and M output bits
+//The function is tabulated once, and its preimages are indexed by output value, so every sample only touches the preimage set of one output
+template <size_t N, size_t M>
+class SimonSampler {
+    private:
+        using index_type = std::conditional_t<N <= 32, uint32_t, uint64_t>;
+
+        //f(x) for every input x
+        std::vector<index_type> values;
+        //All inputs, sorted by their output value, and the offset of the first input for every output value
+        std::vector<index_type> preimages;
+        std::vector<index_type> offsets;
+
+        //Calculates the parity of the given value
+        static inline bool parity(size_t value) {
+            return __builtin_parityll(value);
+        }
+
+        //Samples z from the general distribution over the preimage set, using a Walsh-Hadamard transform of the indicator of the set
+        size_t sampleGeneral(size_t begin, size_t end, RandomStream& rng) const {
+            std::vector<double> spectrum(1ull << N, 0);
+            for(size_t i = begin; i < end; ++i)
+                spectrum[this->preimages[i]] = 1;
+
+            for(size_t width = 1; width < spectrum.size(); width <<= 1) {
+                for(size_t i = 0; i < spectrum.size(); i += width << 1) {
+                    for(size_t j = i; j < i + width; ++j) {
+                        double a = spectrum[j];
+                        double b = spectrum[j + width];
+                        spectrum[j] = a + b;
+                        spectrum[j + width] = a - b;
+                    }
+                }
+            }
+
+            double sample = rng.uniformReal() * double(end - begin) * double(1ull << N);
+            for(size_t z = 0; z < spectrum.size(); ++z) {
+                sample -= spectrum[z] * spectrum[z];
+                if(sample < 0)
+                    return z;
+            }
+            return spectrum.size() - 1;
+        }
+    public:
+        template <typename Func>
+        explicit SimonSampler(Func function) : values(1ull << N), preimages(1ull << N), offsets((1ull << M) + 1, 0) {
+            const size_t output_mask = (1ull << M) - 1;
+            for(size_t x = 0; x < this->values.size(); ++x) {
+                this->values[x] = function(x) & output_mask;
+                ++this->offsets[this->values[x] + 1];
+            }
+
+            //Counting sort of the inputs by output value
+            for(size_t y = 0; y < (1ull << M); ++y)
+                this->offsets[y + 1] += this->offsets[y];
+            std::vector<index_type> next(this->offsets.begin(), this->offsets.end() - 1);
+            for(size_t x = 0; x < this->values.size(); ++x)
+                this->preimages[next[this->values[x]]++] = x;
+        }
+
+        //Samples one run of Simon's algorithm, returning the measured first and second register like run_simon
+        std::pair<size_t, size_t> sample(RandomStream& rng) const {
+            size_t x = rng.uniform(1ull << N);
+            size_t y = this->values[x];
+            size_t begin = this->offsets[y];
+            size_t end = this->offsets[y + 1];
+
+            //A single preimage, the first register is left in a basis state and the Hadamard layer makes z uniform
+            if(end - begin == 1)
+                return std::make_pair(rng.uniform(1ull << N), y);
+
+            //Two preimages x and x ^ s, z is uniform over all values with z.s = 0
+            //A uniform z with z.s = 1 is mapped onto that set by flipping the lowest bit of s, which is a bijection
+            if(end - begin == 2) {
+                size_t s = this->preimages[begin] ^ this->preimages[begin + 1];
+                size_t z = rng.uniform(1ull << N);
+                if(parity(z & s))
+                    z ^= s & -s;
+                return std::make_pair(z, y);
+            }
+
+            return std::make_pair(this->sampleGeneral(begin, end, rng), y);
+        }
+};
+
+#endif
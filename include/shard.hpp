@@ -0,0 +1,397 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_SHARD
+#define QUANTUM_CRYPTO_ATTACK_SHARD
+
+//Dense state vector split into 2^k shards over worker processes, so a register can use the memory and bandwidth of every NUMA node of a host
+//The highest k qubits select the shard, the other qubits index the amplitudes within a shard. Every shard lives in its own POSIX shared memory
+//segment, which all processes map. Worker i is pinned to the CPUs of NUMA node i modulo the number of nodes, and touches its shard first, so
+//the pages of the shard are placed on its node. The register sends every gate to all workers through a shared control block:
+// - gates on the qubits within the shards are applied by every worker to its own shard
+// - gates on a shard qubit pair shard i with shard i ^ bit, and both workers of a pair exchange amplitudes between the two shards, each
+//   processing one half of the pair
+//The number of shards is the number of NUMA nodes rounded down to a power of two, or the value of the QA_SHARDS environment variable
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "native.hpp"
+#include "random.hpp"
+
+//Largest number of shards of a register
+constexpr size_t SHARD_MAX_COUNT = 64;
+
+//Number of NUMA nodes of the host, 1 when the topology is not exposed in sysfs
+inline size_t numa_node_count() {
+    size_t count = 0;
+    while(std::ifstream("/sys/devices/system/node/node" + std::to_string(count) + "/cpulist"))
+        ++count;
+    return std::max<size_t>(count, 1);
+}
+
+//CPUs of a NUMA node, parsed from its cpulist in sysfs, e.g. 0-3,8-11. Empty when the node is not exposed
+inline cpu_set_t numa_node_cpus(size_t node) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string list;
+    if(!(in >> list))
+        return cpus;
+    size_t begin = 0;
+    while(begin < list.size()) {
+        size_t end = list.find(',', begin);
+        if(end == std::string::npos)
+            end = list.size();
+        std::string range = list.substr(begin, end - begin);
+        size_t dash = range.find('-');
+        size_t first = std::stoul(range.substr(0, dash));
+        size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+        for(size_t cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET(cpu, &cpus);
+        begin = end + 1;
+    }
+    return cpus;
+}
+
+//Number of shards configured for this host, the value of QA_SHARDS or the number of NUMA nodes rounded down to a power of two
+inline size_t configured_shard_count() {
+    const char* value = std::getenv("QA_SHARDS");
+    if(value == nullptr) {
+        size_t count = std::min(numa_node_count(), SHARD_MAX_COUNT);
+        while((count & (count - 1)) != 0)
+            count &= count - 1;
+        return count;
+    }
+
+    char* end;
+    size_t count = std::strtoull(value, &end, 10);
+    if(*value == '\0' || *end != '\0' || count == 0 || count > SHARD_MAX_COUNT || (count & (count - 1)) != 0)
+        throw std::invalid_argument("QA_SHARDS has to be a power of two from 1 to " + std::to_string(SHARD_MAX_COUNT) + ": '" + value + "'");
+    return count;
+}
+
+//Number of shards of new registers, read once per process
+//parse_options calls it when the sharded backend is selected, so an invalid QA_SHARDS is reported at startup instead of by every query
+inline size_t shard_count() {
+    static const size_t count = configured_shard_count();
+    return count;
+}
+
+enum class ShardCommandKind : uint32_t {
+    //Hadamard gate on target
+    Hadamard,
+    //X gate on target with the controls in mask and the negated controls in negated
+    Toggle,
+    //Stores the squared norm of every shard in the control block
+    Norm,
+    //Ends the workers
+    Exit
+};
+
+struct ShardCommand {
+    ShardCommandKind kind;
+    uint32_t target;
+    uint64_t mask;
+    uint64_t negated;
+};
+
+//Control block shared by the register and its workers
+//The register writes a command and increments sequence, every worker executes it once and increments done
+struct ShardControl {
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint32_t> done;
+    ShardCommand command;
+    double norms[SHARD_MAX_COUNT];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+    "The shard control block needs lock-free atomics to be shared between processes");
+
+//Waits until value differs from previous, spinning briefly before yielding the CPU
+template <typename T, typename Check>
+T shard_wait_change(const std::atomic<T>& value, T previous, Check check) {
+    for(size_t spin = 0;; ++spin) {
+        T current = value.load(std::memory_order_acquire);
+        if(current != previous)
+            return current;
+        if(spin >= 1024) {
+            sched_yield();
+            if(spin % 65536 == 0)
+                check();
+        }
+    }
+}
+
+template <typename Amplitude>
+class BasicShardedRegister {
+    private:
+        using Real = typename AmplitudeReal<Amplitude>::type;
+
+        size_t width;
+        //Number of qubits selecting the shard, and within a shard
+        size_t shard_qubits;
+        size_t local_qubits;
+        size_t shard_size;
+        std::vector<Amplitude*> shards;
+        ShardControl* control = nullptr;
+        std::vector<pid_t> workers;
+
+        //Ends the workers, and unmaps the segments and the control block
+        void release() {
+            if(this->control != nullptr && !this->workers.empty())
+                this->dispatch({ShardCommandKind::Exit, 0, 0, 0});
+            for(pid_t worker : this->workers)
+                waitpid(worker, nullptr, 0);
+            this->workers.clear();
+            for(Amplitude* shard : this->shards)
+                munmap(shard, this->shard_size * sizeof(Amplitude));
+            this->shards.clear();
+            if(this->control != nullptr)
+                munmap(this->control, sizeof(ShardControl));
+            this->control = nullptr;
+        }
+
+        //Throws when a worker ended, so the register does not wait for it forever
+        void checkWorkers() const {
+            for(pid_t worker : this->workers) {
+                int status;
+                if(waitpid(worker, &status, WNOHANG) == worker)
+                    throw std::runtime_error("Shard worker " + std::to_string(worker) + " ended unexpectedly");
+            }
+        }
+
+        //Sends a command to all workers, and waits until all of them executed it
+        void dispatch(const ShardCommand& command) const {
+            this->control->done.store(0, std::memory_order_relaxed);
+            this->control->command = command;
+            this->control->sequence.fetch_add(1, std::memory_order_release);
+            if(command.kind == ShardCommandKind::Exit)
+                return;
+            uint32_t done = 0;
+            while(done != this->shards.size())
+                done = shard_wait_change<uint32_t>(this->control->done, done, [&] {
+                    this->checkWorkers();
+                });
+        }
+
+        //Applies a command to shard index, or to the half of the pair of shards of index assigned to it
+        void execute(size_t index, const ShardCommand& command) {
+            Amplitude* own = this->shards[index];
+            if(command.kind == ShardCommandKind::Norm) {
+                double norm = 0;
+                for(size_t i = 0; i < this->shard_size; ++i)
+                    norm += std::norm(own[i]);
+                this->control->norms[index] = norm;
+                return;
+            }
+
+            const uint64_t local_mask = this->shard_size - 1;
+            const uint64_t shard_support = (command.mask | command.negated) >> this->local_qubits;
+            const uint64_t shard_mask = command.mask >> this->local_qubits;
+            const uint64_t support = (command.mask | command.negated) & local_mask;
+            const uint64_t mask = command.mask & local_mask;
+            if(command.target < this->local_qubits) {
+                if(command.kind == ShardCommandKind::Hadamard)
+                    native_hadamard(own, this->shard_size, command.target);
+                else if((index & shard_support) != shard_mask)
+                    return;
+                else if(support == 0)
+                    native_sigma_x(own, this->shard_size, command.target);
+                else
+                    native_toffoli_mask(own, this->shard_size, mask, command.target, command.negated & local_mask);
+                return;
+            }
+
+            const size_t partner = index ^ (size_t(1) << (command.target - this->local_qubits));
+            Amplitude* low = this->shards[std::min(index, partner)];
+            Amplitude* high = this->shards[std::max(index, partner)];
+            const size_t begin = index < partner ? 0 : this->shard_size / 2;
+            const size_t end = begin + this->shard_size / 2;
+            if(command.kind == ShardCommandKind::Hadamard) {
+                const Real factor = std::sqrt(Real(0.5));
+                for(size_t i = begin; i < end; ++i) {
+                    Amplitude a = low[i];
+                    Amplitude b = high[i];
+                    low[i] = (a + b) * factor;
+                    high[i] = (a - b) * factor;
+                }
+                return;
+            }
+            if((index & shard_support) != shard_mask)
+                return;
+            for(size_t i = begin; i < end; ++i)
+                if((i & support) == mask)
+                    std::swap(low[i], high[i]);
+        }
+
+        [[noreturn]] void runWorker(size_t index, const cpu_set_t& cpus, size_t initial, pid_t parent) {
+            //Ends with the process of the register, which may already have ended before the signal was requested
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if(getppid() != parent)
+                _exit(1);
+            if(CPU_COUNT(&cpus) > 0)
+                sched_setaffinity(0, sizeof(cpus), &cpus);
+            //First touch places the pages of the shard on the node of the worker
+            Amplitude* own = this->shards[index];
+            for(size_t i = 0; i < this->shard_size; ++i)
+                own[i] = 0;
+            if(initial >> this->local_qubits == index)
+                own[initial & (this->shard_size - 1)] = 1;
+            this->control->done.fetch_add(1, std::memory_order_release);
+
+            uint64_t sequence = 0;
+            while(true) {
+                sequence = shard_wait_change<uint64_t>(this->control->sequence, sequence, [] {});
+                ShardCommand command = this->control->command;
+                if(command.kind == ShardCommandKind::Exit)
+                    _exit(0);
+                this->execute(index, command);
+                this->control->done.fetch_add(1, std::memory_order_release);
+            }
+        }
+
+    public:
+        //Creates a register of width qubits in basis state initial, starting one worker process per shard
+        explicit BasicShardedRegister(size_t width, size_t initial = 0) : width(width) {
+            static std::atomic<uint64_t> registers(0);
+            size_t count = shard_count();
+            while(count > 1 && (size_t(1) << width) < 2 * count)
+                count /= 2;
+            this->shard_qubits = __builtin_ctzll(count);
+            this->local_qubits = width - this->shard_qubits;
+            this->shard_size = size_t(1) << this->local_qubits;
+
+            void* control = mmap(nullptr, sizeof(ShardControl), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            if(control == MAP_FAILED)
+                throw std::runtime_error("Could not map the shard control block");
+            this->control = new(control) ShardControl();
+
+            //The segments are unlinked once mapped, the mappings are inherited by the workers and vanish with the processes
+            std::string prefix = "/qa-shard-" + std::to_string(getpid()) + "-" + std::to_string(registers++) + "-";
+            for(size_t i = 0; i < count; ++i) {
+                std::string name = prefix + std::to_string(i);
+                int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+                if(fd < 0) {
+                    this->release();
+                    throw std::runtime_error("Could not create shared memory segment " + name);
+                }
+                void* shard = MAP_FAILED;
+                if(ftruncate(fd, this->shard_size * sizeof(Amplitude)) == 0)
+                    shard = mmap(nullptr, this->shard_size * sizeof(Amplitude), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                close(fd);
+                shm_unlink(name.c_str());
+                if(shard == MAP_FAILED) {
+                    this->release();
+                    throw std::runtime_error("Could not map shared memory segment " + name);
+                }
+                this->shards.push_back(static_cast<Amplitude*>(shard));
+            }
+
+            //CPU sets are read before forking, so the workers do not allocate
+            size_t nodes = numa_node_count();
+            std::vector<cpu_set_t> cpus;
+            for(size_t i = 0; i < count; ++i)
+                cpus.push_back(numa_node_cpus(i % nodes));
+            const pid_t parent = getpid();
+            for(size_t i = 0; i < count; ++i) {
+                pid_t worker = fork();
+                if(worker == 0)
+                    this->runWorker(i, cpus[i], initial, parent);
+                if(worker < 0) {
+                    this->release();
+                    throw std::runtime_error("Could not start shard worker");
+                }
+                this->workers.push_back(worker);
+            }
+
+            try {
+                uint32_t done = 0;
+                while(done != count)
+                    done = shard_wait_change<uint32_t>(this->control->done, done, [&] {
+                        this->checkWorkers();
+                    });
+            } catch(...) {
+                this->release();
+                throw;
+            }
+        }
+
+        BasicShardedRegister(const BasicShardedRegister&) = delete;
+        BasicShardedRegister& operator=(const BasicShardedRegister&) = delete;
+
+        ~BasicShardedRegister() {
+            this->release();
+        }
+
+        inline size_t getWidth() const {
+            return this->width;
+        }
+
+        inline size_t getShards() const {
+            return this->shards.size();
+        }
+
+        void hadamard(size_t target) {
+            this->dispatch({ShardCommandKind::Hadamard, uint32_t(target), 0, 0});
+        }
+
+        void sigmaX(size_t target) {
+            this->toffoliMask(0, target);
+        }
+
+        //Toggles target in every basis state where all bits in control_mask are set, and all bits in negated_mask are clear
+        void toffoliMask(uint64_t control_mask, size_t target, uint64_t negated_mask = 0) {
+            this->dispatch({ShardCommandKind::Toggle, uint32_t(target), control_mask, negated_mask});
+        }
+
+        void toffoli(const size_t* controls, size_t count, size_t target) {
+            uint64_t control_mask = 0;
+            for(size_t i = 0; i < count; ++i)
+                control_mask |= uint64_t(1) << controls[i];
+            this->toffoliMask(control_mask, target);
+        }
+
+        //Samples a measurement of the full register, selecting a shard by the norms computed by the workers and a state within it
+        size_t measure(RandomStream& rng) const {
+            this->dispatch({ShardCommandKind::Norm, 0, 0, 0});
+            double total = 0;
+            for(size_t i = 0; i < this->shards.size(); ++i)
+                total += this->control->norms[i];
+
+            double sample = rng.uniformReal() * total;
+            for(size_t i = 0; i < this->shards.size(); ++i) {
+                if(sample >= this->control->norms[i] && i + 1 < this->shards.size()) {
+                    sample -= this->control->norms[i];
+                    continue;
+                }
+                for(size_t j = 0; j < this->shard_size; ++j) {
+                    sample -= std::norm(this->shards[i][j]);
+                    if(sample < 0)
+                        return i << this->local_qubits | j;
+                }
+                return i << this->local_qubits | (this->shard_size - 1);
+            }
+            return (size_t(1) << this->width) - 1;
+        }
+};
+
+using ShardedRegister = BasicShardedRegister<std::complex<double>>;
+using RealShardedRegister = BasicShardedRegister<double>;
+
+#endif
@@ -1,28 +1,120 @@
 #ifndef QUANTUM_CRYPTO_ATTACK_SIMON
 #define QUANTUM_CRYPTO_ATTACK_SIMON
 
+#include <type_traits>
+#include <utility>
+
+#include "instrument.hpp"
 #include "quantum.hpp"
+#include "random.hpp"
+#include "register.hpp"
+#include "trace.hpp"
 
-//Runs Simon's algorithm
-//uf_callback has to be a function satisfying Uf|x>|y> -> |x>|y xor f(x)>
-template <size_t N, size_t M, typename T>
-std::pair<size_t, size_t> run_simon(T uf_callback) {
-    quantum_reg reg = quantum_new_qureg(0, N + M);
+//Measures the full register, sampling the outcome from its amplitudes with the given random stream
+//This replaces quantum_measure, which draws from libquantum's global generator and is neither reproducible per trial nor thread-safe
+inline size_t measure_register(const quantum_reg& reg, RandomStream& rng) {
+    //Normalise by the total probability, the single precision amplitudes of libquantum do not sum to exactly 1
+    double total = 0;
+    for(int i = 0; i < reg.size; ++i)
+        total += quantum_prob(reg.amplitude[i]);
 
-    for(size_t i = 0; i < N; ++i)
-        quantum_hadamard(i, &reg);
+    double sample = rng.uniformReal() * total;
+    for(int i = 0; i < reg.size; ++i) {
+        sample -= quantum_prob(reg.amplitude[i]);
+        if(sample < 0)
+            return reg.state[i];
+    }
+    return reg.state[reg.size - 1];
+}
+
+template <typename T, typename = void>
+struct HasAncillas : std::false_type {};
 
-    uf_callback(&reg);
+template <typename T>
+struct HasAncillas<T, std::void_t<decltype(std::declval<const T&>().ancillas())>> : std::true_type {};
 
+//Number of ancilla qubits an oracle needs above the N + M qubits of Simon's algorithm, returned to |0> by the oracle
+//Oracles declare them with an ancillas() member function, see FeistelOracle, other oracles need none
+template <typename T>
+size_t oracle_ancillas(const T& oracle) {
+    if constexpr(HasAncillas<T>::value)
+        return oracle.ancillas();
+    else
+        return 0;
+}
+
+template <typename T, typename = void>
+struct HasRealGates : std::false_type {};
+
+template <typename T>
+struct HasRealGates<T, std::void_t<decltype(std::declval<const T&>().realGates())>> : std::true_type {};
+
+//Whether an oracle only applies gates with real matrices, so Simon's algorithm on it can be simulated with real amplitudes
+//All gates of the register interface of register.hpp are real, oracles replaying circuits check theirs with a realGates() member function
+template <typename T>
+bool oracle_is_real(const T& oracle) {
+    if constexpr(HasRealGates<T>::value)
+        return oracle.realGates();
+    else
+        return true;
+}
+
+//Applies a Hadamard gate to each of the first N qubits of a register
+template <size_t N, typename Reg>
+inline void apply_hadamard_layer(Reg* reg) {
+    QA_TIME_SCOPE(Hadamard);
+    QA_TRACE_SCOPE("gate", "hadamard-layer");
     for(size_t i = 0; i < N; ++i)
-        quantum_hadamard(i, &reg);
+        apply_hadamard(reg, i);
+}
+
+//Applies the circuit of Simon's algorithm up to the measurement, to a register holding N + M qubits in state |0>
+template <size_t N, typename Reg, typename T>
+void run_simon_circuit(Reg* reg, T uf_callback) {
+    apply_hadamard_layer<N>(reg);
+    {
+        QA_TIME_SCOPE(Oracle);
+        QA_TRACE_SCOPE("gate", "oracle");
+        uf_callback(reg);
+    }
+    apply_hadamard_layer<N>(reg);
+}
+
+//Runs Simon's algorithm on a register of type Reg, which is either a libquantum register or one of our own register types (see register.hpp)
+//uf_callback has to be a function satisfying Uf|x>|y> -> |x>|y xor f(x)>
+//The measurement is sampled using the given random stream, the register is widened by the ancillas of the oracle, see oracle_ancillas
+template <size_t N, size_t M, typename Reg = quantum_reg, typename T>
+std::pair<size_t, size_t> run_simon(T uf_callback, RandomStream& rng) {
+    QA_TRACE_SCOPE("simon", "run_simon");
+    const size_t width = N + M + oracle_ancillas(uf_callback);
+    size_t result;
+    if constexpr(std::is_same_v<Reg, quantum_reg>) {
+        quantum_reg reg = quantum_new_qureg(0, width);
+
+        run_simon_circuit<N>(&reg, uf_callback);
+
+        {
+            QA_TIME_SCOPE(Measurement);
+            QA_TRACE_SCOPE("gate", "measure");
+            result = measure_register(reg, rng);
+        }
+
+        quantum_delete_qureg(&reg);
+    }
+    else {
+        Reg reg(width);
 
-    size_t result = quantum_measure(reg);
+        run_simon_circuit<N>(&reg, uf_callback);
 
-    quantum_delete_qureg(&reg);
+        {
+            QA_TIME_SCOPE(Measurement);
+            QA_TRACE_SCOPE("gate", "measure");
+            result = reg.measure(rng);
+        }
+    }
 
     size_t result_x = result & ((1ull << N) - 1);
-    size_t result_y = result >> N;
+    size_t result_y = (result >> N) & ((1ull << M) - 1);
 
     return std::make_pair(result_x, result_y);
 }
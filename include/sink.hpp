@@ -0,0 +1,246 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_SINK
+#define QUANTUM_CRYPTO_ATTACK_SINK
+
+//Streaming output of trial results for long experiment runs
+//Worker threads append fixed-layout records to their own lock-free ring buffer, a background writer thread drains the buffers,
+//restores the order of the records and writes them as JSONL or CSV, so workers never block on I/O or on each other
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "detect.hpp"
+#include "report.hpp"
+#include "trials.hpp"
+
+//Output format of a result sink
+enum class SinkFormat {
+    //One JSON object per line
+    Jsonl,
+    //Comma-separated values with a header line
+    Csv
+};
+
+//Fixed-layout record of a single trial result, as passed from the workers to the writer
+struct TrialRecord {
+    //Position of the record in the output, records are written in order of increasing sequence number without gaps
+    uint64_t sequence;
+    Backend backend;
+    uint32_t bits;
+    uint32_t rounds;
+    uint64_t trial;
+    TrialKind kind;
+    DetectionVerdict verdict;
+    uint64_t s;
+    uint32_t queries;
+    uint32_t inconsistent;
+    DetectionTimings timings;
+    double seconds;
+};
+
+//Builds the record of a trial result of a batch with the given configuration and half block size
+inline TrialRecord make_trial_record(uint64_t sequence, size_t bits, const TrialConfig& config, const TrialResult& result) {
+    return {
+        sequence,
+        config.backend,
+        uint32_t(bits),
+        uint32_t(config.rounds),
+        result.trial,
+        result.kind,
+        result.detection.verdict,
+        result.detection.s,
+        uint32_t(result.detection.queries),
+        uint32_t(result.detection.inconsistent),
+        result.detection.timings,
+        result.seconds
+    };
+}
+
+//Rebuilds the trial result a record was made from
+inline TrialResult trial_result_of(const TrialRecord& record) {
+    TrialResult result;
+    result.trial = record.trial;
+    result.kind = record.kind;
+    result.detection = {record.verdict, record.s, record.queries, record.inconsistent, record.timings};
+    result.seconds = record.seconds;
+    return result;
+}
+
+//Bounded single-producer single-consumer queue of records
+class RecordRing {
+    private:
+        std::unique_ptr<TrialRecord[]> records;
+        size_t mask;
+        //Next position to read and to write, on separate cache lines so producer and consumer do not share a line
+        alignas(64) std::atomic<size_t> head;
+        alignas(64) std::atomic<size_t> tail;
+    public:
+        //The capacity is rounded up to a power of two
+        explicit RecordRing(size_t capacity) : head(0), tail(0) {
+            size_t size = 1;
+            while(size < capacity)
+                size <<= 1;
+            this->records.reset(new TrialRecord[size]);
+            this->mask = size - 1;
+        }
+
+        //Appends a record, returns false when the queue is full, may only be called by the producer
+        bool push(const TrialRecord& record) {
+            size_t tail = this->tail.load(std::memory_order_relaxed);
+            if(tail - this->head.load(std::memory_order_acquire) > this->mask)
+                return false;
+            this->records[tail & this->mask] = record;
+            this->tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        //Removes the oldest record, returns false when the queue is empty, may only be called by the consumer
+        bool pop(TrialRecord& record) {
+            size_t head = this->head.load(std::memory_order_relaxed);
+            if(head == this->tail.load(std::memory_order_acquire))
+                return false;
+            record = this->records[head & this->mask];
+            this->head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+};
+
+//Writes trial records to a file in sequence order, using one ring buffer per producer thread
+//Producers are identified by a dense index, such as the worker index passed to ThreadPool tasks
+class ResultSink {
+    private:
+        int fd;
+        SinkFormat format;
+        std::vector<std::unique_ptr<RecordRing>> rings;
+        //Interval between two fsync calls of the writer
+        std::chrono::duration<double> sync_interval;
+        std::atomic<bool> stopping;
+        std::atomic<bool> failed;
+        std::thread writer;
+
+        //Formats a record as a single line, including the line break
+        void formatRecord(const TrialRecord& record, std::string& out) const {
+            char line[512];
+            const char* pattern = this->format == SinkFormat::Jsonl
+                ? "{\"sequence\":%llu,\"backend\":\"%s\",\"bits\":%u,\"rounds\":%u,\"trial\":%llu,\"kind\":\"%s\",\"verdict\":\"%s\",\"s\":%llu,"
+                  "\"queries\":%u,\"inconsistent\":%u,\"setup\":%.9g,\"simon\":%.9g,\"solve\":%.9g,\"verify\":%.9g,\"seconds\":%.9g}\n"
+                : "%llu,%s,%u,%u,%llu,%s,%s,%llu,%u,%u,%.9g,%.9g,%.9g,%.9g,%.9g\n";
+            int length = std::snprintf(line, sizeof(line), pattern,
+                (unsigned long long) record.sequence, backend_name(record.backend), record.bits, record.rounds,
+                (unsigned long long) record.trial, kind_name(record.kind), verdict_name(record.verdict), (unsigned long long) record.s,
+                record.queries, record.inconsistent, record.timings.setup, record.timings.simon, record.timings.solve, record.timings.verify,
+                record.seconds);
+            out.append(line, length);
+        }
+
+        //Writes the entire buffer to the file, and clears it
+        void writeBuffer(std::string& buffer) {
+            size_t written = 0;
+            while(written < buffer.size()) {
+                ssize_t result = ::write(this->fd, buffer.data() + written, buffer.size() - written);
+                if(result < 0) {
+                    this->failed = true;
+                    break;
+                }
+                written += result;
+            }
+            buffer.clear();
+        }
+
+        void run() {
+            //Records that arrived ahead of their turn, keyed by sequence number
+            std::map<uint64_t, TrialRecord> pending;
+            uint64_t next_sequence = 0;
+            std::string buffer;
+            auto last_sync = std::chrono::steady_clock::now();
+
+            while(true) {
+                //Read the stop flag before draining, so no record pushed before stopping is missed
+                bool stop = this->stopping.load(std::memory_order_acquire);
+
+                TrialRecord record;
+                bool received = false;
+                for(std::unique_ptr<RecordRing>& ring : this->rings) {
+                    while(ring->pop(record)) {
+                        pending.emplace(record.sequence, record);
+                        received = true;
+                    }
+                }
+                for(auto next = pending.begin(); next != pending.end() && next->first == next_sequence; next = pending.erase(next)) {
+                    this->formatRecord(next->second, buffer);
+                    ++next_sequence;
+                }
+                if(buffer.size() >= (1 << 16) || (stop && !buffer.empty()))
+                    this->writeBuffer(buffer);
+
+                auto now = std::chrono::steady_clock::now();
+                if(now - last_sync >= this->sync_interval || stop) {
+                    this->writeBuffer(buffer);
+                    fsync(this->fd);
+                    last_sync = now;
+                }
+                if(stop)
+                    return;
+                if(!received)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+    public:
+        //Creates or truncates the file at path, and starts the writer thread
+        //Every producer may buffer up to capacity records before it has to wait for the writer
+        ResultSink(const std::string& path, SinkFormat format, size_t producers, double sync_seconds = 1, size_t capacity = 4096)
+            : format(format), sync_interval(sync_seconds), stopping(false), failed(false) {
+            this->fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if(this->fd < 0)
+                throw std::runtime_error("Could not create result file " + path);
+            for(size_t i = 0; i < producers; ++i)
+                this->rings.emplace_back(new RecordRing(capacity));
+
+            if(format == SinkFormat::Csv) {
+                std::string header = "sequence,backend,bits,rounds,trial,kind,verdict,s,queries,inconsistent,setup,simon,solve,verify,seconds\n";
+                this->writeBuffer(header);
+            }
+            this->writer = std::thread(&ResultSink::run, this);
+        }
+
+        ResultSink(const ResultSink&) = delete;
+        ResultSink& operator=(const ResultSink&) = delete;
+
+        ~ResultSink() {
+            try {
+                this->close();
+            }
+            catch(const std::runtime_error& e) {
+            }
+        }
+
+        //Appends a record from the given producer, waiting for the writer while the producer's buffer is full
+        void push(size_t producer, const TrialRecord& record) {
+            while(!this->rings[producer]->push(record))
+                std::this_thread::yield();
+        }
+
+        //Writes all pushed records, syncs the file and stops the writer, throws if any write failed
+        //All records up to the highest pushed sequence number have to be pushed before closing, later records are dropped
+        void close() {
+            if(this->fd < 0)
+                return;
+            this->stopping.store(true, std::memory_order_release);
+            this->writer.join();
+            ::close(this->fd);
+            this->fd = -1;
+            if(this->failed)
+                throw std::runtime_error("Could not write result file");
+        }
+};
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_SPARSE
+#define QUANTUM_CRYPTO_ATTACK_SPARSE
+
+//Sparse state vector simulator, storing only the basis states with a non-zero amplitude, as a flat array of (state, amplitude) entries
+//Between the Hadamard layers of Simon's algorithm the oracle only permutes basis states, and only 2^N of the 2^(N + M) states are non-zero.
+//X gates update the states of the matching entries in place, which never collides as they are permutations. A Hadamard gate splits every
+//entry in two, after which the entries are radix sorted by state and entries of equal states are merged, dropping the ones that cancel.
+//Once more than a fraction SPARSE_DENSE_FILL of all states are non-zero, the register moves its state into a dense native register
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "native.hpp"
+#include "random.hpp"
+
+//Fill ratio above which the sparse register switches to dense storage
+//An entry takes twice the memory of a dense amplitude and its gates visit every entry, so dense storage wins well before half of the states are set
+constexpr double SPARSE_DENSE_FILL = 1.0 / 16;
+
+//Number of bits of the state sorted per pass of the radix sort
+constexpr size_t SPARSE_RADIX_BITS = 11;
+
+template <typename Amplitude>
+class BasicSparseRegister {
+    private:
+        using Real = typename AmplitudeReal<Amplitude>::type;
+
+        struct Entry {
+            uint64_t state;
+            Amplitude amplitude;
+        };
+
+        size_t width;
+        std::vector<Entry> entries;
+        //Scratch space of the radix sort, kept between gates to avoid reallocation
+        std::vector<Entry> scratch;
+        //The dense register holding the state after the switch to dense storage, otherwise null
+        std::unique_ptr<BasicNativeRegister<Amplitude>> dense;
+
+        //Sorts the entries by state, in passes of SPARSE_RADIX_BITS bits from the lowest to the highest bit of the register
+        void sortEntries() {
+            this->scratch.resize(this->entries.size());
+            std::vector<size_t> counts(size_t(1) << SPARSE_RADIX_BITS);
+            for(size_t shift = 0; shift < this->width; shift += SPARSE_RADIX_BITS) {
+                const uint64_t digit_mask = (uint64_t(1) << SPARSE_RADIX_BITS) - 1;
+                std::fill(counts.begin(), counts.end(), 0);
+                for(const Entry& entry : this->entries)
+                    ++counts[(entry.state >> shift) & digit_mask];
+                size_t offset = 0;
+                for(size_t& count : counts) {
+                    size_t current = count;
+                    count = offset;
+                    offset += current;
+                }
+                for(const Entry& entry : this->entries)
+                    this->scratch[counts[(entry.state >> shift) & digit_mask]++] = entry;
+                this->entries.swap(this->scratch);
+            }
+        }
+
+        //Merges the sorted entries of equal states, and drops the entries whose amplitudes cancelled
+        void mergeEntries() {
+            size_t kept = 0;
+            for(size_t i = 0; i < this->entries.size();) {
+                Entry merged = this->entries[i];
+                for(++i; i < this->entries.size() && this->entries[i].state == merged.state; ++i)
+                    merged.amplitude += this->entries[i].amplitude;
+                if(std::norm(merged.amplitude) > 1e-24)
+                    this->entries[kept++] = merged;
+            }
+            this->entries.resize(kept);
+        }
+
+        void switchToDense() {
+            this->dense.reset(new BasicNativeRegister<Amplitude>(this->width));
+            this->dense->setAmplitude(0, 0);
+            for(const Entry& entry : this->entries)
+                this->dense->setAmplitude(entry.state, entry.amplitude);
+            this->entries = std::vector<Entry>();
+            this->scratch = std::vector<Entry>();
+        }
+
+    public:
+        //Creates a register of width qubits in basis state initial
+        explicit BasicSparseRegister(size_t width, size_t initial = 0) : width(width) {
+            if(width > 64)
+                throw std::runtime_error("Register too wide for the sparse backend");
+            this->entries.push_back({initial, 1});
+        }
+
+        inline size_t getWidth() const {
+            return this->width;
+        }
+
+        inline bool isDense() const {
+            return this->dense != nullptr;
+        }
+
+        //Number of stored basis states, or all basis states after the switch to dense storage
+        inline size_t size() const {
+            return this->dense ? size_t(1) << this->width : this->entries.size();
+        }
+
+        void hadamard(size_t target) {
+            if(this->dense) {
+                this->dense->hadamard(target);
+                return;
+            }
+
+            const uint64_t bit = uint64_t(1) << target;
+            const Real factor = std::sqrt(Real(0.5));
+            const size_t count = this->entries.size();
+            this->entries.resize(2 * count);
+            for(size_t i = 0; i < count; ++i) {
+                Entry& entry = this->entries[i];
+                Amplitude amplitude = entry.amplitude * factor;
+                bool set = (entry.state & bit) != 0;
+                this->entries[count + i] = {entry.state | bit, set ? -amplitude : amplitude};
+                entry = {entry.state & ~bit, amplitude};
+            }
+            this->sortEntries();
+            this->mergeEntries();
+
+            //Dense storage needs 2^width amplitudes, beyond the native backend the register stays sparse
+            if(this->width < 48 && this->entries.size() > SPARSE_DENSE_FILL * double(uint64_t(1) << this->width))
+                this->switchToDense();
+        }
+
+        void sigmaX(size_t target) {
+            this->toffoliMask(0, target);
+        }
+
+        //Toggles target in every basis state where all bits in control_mask are set, and all bits in negated_mask are clear
+        void toffoliMask(uint64_t control_mask, size_t target, uint64_t negated_mask = 0) {
+            if(this->dense) {
+                this->dense->toffoliMask(control_mask, target, negated_mask);
+                return;
+            }
+
+            const uint64_t bit = uint64_t(1) << target;
+            const uint64_t support = control_mask | negated_mask;
+            for(Entry& entry : this->entries)
+                if((entry.state & support) == control_mask)
+                    entry.state ^= bit;
+        }
+
+        void toffoli(const size_t* controls, size_t count, size_t target) {
+            uint64_t control_mask = 0;
+            for(size_t i = 0; i < count; ++i)
+                control_mask |= uint64_t(1) << controls[i];
+            this->toffoliMask(control_mask, target);
+        }
+
+        //Samples a measurement of the full register
+        size_t measure(RandomStream& rng) const {
+            if(this->dense)
+                return this->dense->measure(rng);
+
+            double total = 0;
+            for(const Entry& entry : this->entries)
+                total += std::norm(entry.amplitude);
+
+            double sample = rng.uniformReal() * total;
+            for(const Entry& entry : this->entries) {
+                sample -= std::norm(entry.amplitude);
+                if(sample < 0)
+                    return entry.state;
+            }
+            return this->entries.back().state;
+        }
+};
+
+using SparseRegister = BasicSparseRegister<std::complex<double>>;
+using RealSparseRegister = BasicSparseRegister<double>;
+
+#endif
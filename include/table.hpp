@@ -0,0 +1,359 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_TABLE
+#define QUANTUM_CRYPTO_ATTACK_TABLE
+
+//On-disk lookup tables for oracle functions
+//Tables are written once and mapped read-only afterwards, so every process using the same table shares a single page cache copy
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "instrument.hpp"
+#include "trace.hpp"
+
+//Version of the table file layout, has to be incremented whenever the header or the element encoding changes
+constexpr uint32_t TABLE_VERSION = 4;
+constexpr char TABLE_MAGIC[8] = {'Q', 'A', 'T', 'A', 'B', 'L', 'E', '\0'};
+
+//Identifies the function stored in a table
+enum class TableCipher : uint32_t {
+    Feistel = 1,
+    RandomPermutation = 2
+};
+
+//Header at the start of every table file, the elements directly follow the header
+//Elements are stored in native byte order, using element_width bytes per element
+struct TableHeader {
+    char magic[8];
+    uint32_t version;
+    //Function stored in the table, one of TableCipher
+    uint32_t cipher;
+    //Half block size and number of rounds of the tabulated function, rounds is 0 when not applicable
+    uint32_t bits;
+    uint32_t rounds;
+    //Experiment seed from which all keys of the tabulated function were derived
+    uint64_t key_seed;
+    //Trial id of the tabulated function, every trial draws its own keys from the experiment seed
+    uint32_t trial;
+    //Number of bytes per element, and the number of elements
+    uint32_t element_width;
+    uint64_t count;
+    //Checksum over the element data
+    uint64_t checksum;
+    //Width of the S-boxes of the round function of feistel networks, 0 when not applicable
+    uint32_t sbox_width;
+    uint32_t padding;
+};
+static_assert(sizeof(TableHeader) == 64, "TableHeader layout is part of the file format");
+
+//Returns the smallest supported element width in bytes able to hold values of the given number of bits
+inline uint32_t table_element_width(size_t value_bits) {
+    if(value_bits <= 8)
+        return 1;
+    if(value_bits <= 16)
+        return 2;
+    if(value_bits <= 32)
+        return 4;
+    return 8;
+}
+
+//Creates the header describing a table, the checksum is filled in when the table is written
+inline TableHeader make_table_header(TableCipher cipher, size_t bits, size_t rounds, size_t sbox_width, uint64_t key_seed, size_t trial, size_t value_bits, size_t count) {
+    TableHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC));
+    header.version = TABLE_VERSION;
+    header.cipher = static_cast<uint32_t>(cipher);
+    header.bits = bits;
+    header.rounds = rounds;
+    header.sbox_width = sbox_width;
+    header.key_seed = key_seed;
+    header.trial = trial;
+    header.element_width = table_element_width(value_bits);
+    header.count = count;
+    return header;
+}
+
+//Builds the canonical file name of a table inside the given directory, tables with equal parameters map to the same file
+inline std::string table_path(const std::string& directory, const TableHeader& header) {
+    const char* name = static_cast<TableCipher>(header.cipher) == TableCipher::Feistel ? "feistel" : "random";
+    return directory + "/" + name
+        + "-b" + std::to_string(header.bits)
+        + "-r" + std::to_string(header.rounds)
+        + "-w" + std::to_string(header.sbox_width)
+        + "-s" + std::to_string(header.key_seed)
+        + "-t" + std::to_string(header.trial)
+        + "-v" + std::to_string(header.version) + ".qat";
+}
+
+//Calculates the checksum of the element data, FNV-1a over 64-bit words followed by the remaining bytes
+inline uint64_t table_checksum(const uint8_t* data, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    size_t i = 0;
+    for(; i + 8 <= length; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0x100000001b3ull;
+    }
+    for(; i < length; ++i)
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+//Reads element index from a table with the given element width
+inline size_t read_table_element(const uint8_t* data, size_t width, size_t index) {
+    switch(width) {
+        case 1:
+            return data[index];
+        case 2: {
+            uint16_t value;
+            std::memcpy(&value, data + 2 * index, 2);
+            return value;
+        }
+        case 4: {
+            uint32_t value;
+            std::memcpy(&value, data + 4 * index, 4);
+            return value;
+        }
+        default: {
+            uint64_t value;
+            std::memcpy(&value, data + 8 * index, 8);
+            return value;
+        }
+    }
+}
+
+//Writes element index in a table with the given element width
+inline void write_table_element(uint8_t* data, size_t width, size_t index, size_t value) {
+    switch(width) {
+        case 1:
+            data[index] = static_cast<uint8_t>(value);
+            break;
+        case 2: {
+            uint16_t narrow = static_cast<uint16_t>(value);
+            std::memcpy(data + 2 * index, &narrow, 2);
+            break;
+        }
+        case 4: {
+            uint32_t narrow = static_cast<uint32_t>(value);
+            std::memcpy(data + 4 * index, &narrow, 4);
+            break;
+        }
+        default: {
+            uint64_t wide = value;
+            std::memcpy(data + 8 * index, &wide, 8);
+            break;
+        }
+    }
+}
+
+//Number of table files started by this process, used to give every temporary table file its own name
+inline std::atomic<size_t>& table_write_counter() {
+    static std::atomic<size_t> writes(0);
+    return writes;
+}
+
+//Evaluates function for every input in [0, header.count) and writes the results as a table file
+//The table is written to a temporary file first and renamed into place, so concurrent writers and readers never observe a partial table
+template <typename Func>
+void write_table(const std::string& path, TableHeader header, Func function) {
+    //The temporary name is unique per process and call, so threads writing the same table do not collide either
+    QA_TIME_SCOPE(TableBuild);
+    QA_TRACE_SCOPE("table", "write_table", header.count);
+    std::string temporary_path = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(table_write_counter()++);
+    size_t data_size = header.count * header.element_width;
+    size_t file_size = sizeof(TableHeader) + data_size;
+
+    int fd = open(temporary_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+        throw std::runtime_error("Could not create table file " + temporary_path);
+    if(ftruncate(fd, file_size) != 0) {
+        close(fd);
+        unlink(temporary_path.c_str());
+        throw std::runtime_error("Could not resize table file " + temporary_path);
+    }
+    void* mapping = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED) {
+        unlink(temporary_path.c_str());
+        throw std::runtime_error("Could not map table file " + temporary_path);
+    }
+
+    //Tabulate the function directly into the mapping, and finish the header once the checksum is known
+    uint8_t* data = static_cast<uint8_t*>(mapping) + sizeof(TableHeader);
+    for(size_t i = 0; i < header.count; ++i)
+        write_table_element(data, header.element_width, i, function(i));
+    header.checksum = table_checksum(data, data_size);
+    std::memcpy(mapping, &header, sizeof(TableHeader));
+
+    bool synced = msync(mapping, file_size, MS_SYNC) == 0;
+    munmap(mapping, file_size);
+    if(!synced || rename(temporary_path.c_str(), path.c_str()) != 0) {
+        unlink(temporary_path.c_str());
+        throw std::runtime_error("Could not write table file " + path);
+    }
+}
+
+//Read-only view of a table file mapped into memory
+class MappedTable {
+    private:
+        void* mapping;
+        size_t mapping_size;
+        const TableHeader* header;
+        const uint8_t* data;
+
+        //Checks whether the mapped header describes the expected table, the checksum is not compared
+        bool matches(const TableHeader& expected) const {
+            return std::memcmp(this->header->magic, TABLE_MAGIC, sizeof(TABLE_MAGIC)) == 0
+                && this->header->version == expected.version
+                && this->header->cipher == expected.cipher
+                && this->header->bits == expected.bits
+                && this->header->rounds == expected.rounds
+                && this->header->sbox_width == expected.sbox_width
+                && this->header->key_seed == expected.key_seed
+                && this->header->trial == expected.trial
+                && this->header->element_width == expected.element_width
+                && this->header->count == expected.count
+                && this->mapping_size == sizeof(TableHeader) + expected.count * expected.element_width;
+        }
+
+        void release() {
+            if(this->mapping != nullptr)
+                munmap(this->mapping, this->mapping_size);
+            this->mapping = nullptr;
+        }
+    public:
+        //Maps the table at path, throws if the file does not exist or does not match the expected header
+        MappedTable(const std::string& path, const TableHeader& expected) : mapping(nullptr), mapping_size(0), header(nullptr), data(nullptr) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if(fd < 0)
+                throw std::runtime_error("Could not open table file " + path);
+
+            struct stat info;
+            if(fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(TableHeader)) {
+                close(fd);
+                throw std::runtime_error("Invalid table file " + path);
+            }
+            this->mapping_size = info.st_size;
+            this->mapping = mmap(nullptr, this->mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if(this->mapping == MAP_FAILED) {
+                this->mapping = nullptr;
+                throw std::runtime_error("Could not map table file " + path);
+            }
+
+            this->header = static_cast<const TableHeader*>(this->mapping);
+            this->data = static_cast<const uint8_t*>(this->mapping) + sizeof(TableHeader);
+            if(!this->matches(expected)) {
+                this->release();
+                throw std::runtime_error("Table file " + path + " does not match the requested table");
+            }
+        }
+
+        MappedTable(const MappedTable&) = delete;
+        MappedTable& operator=(const MappedTable&) = delete;
+
+        MappedTable(MappedTable&& other) : mapping(other.mapping), mapping_size(other.mapping_size), header(other.header), data(other.data) {
+            other.mapping = nullptr;
+        }
+
+        ~MappedTable() {
+            this->release();
+        }
+
+        //Maps the table at path, writing it first using generator when it is missing, was created with other parameters,
+        //or fails its checksum when check_elements is set. Without check_elements only the header of an existing file is checked
+        template <typename Func>
+        static MappedTable openOrCreate(const std::string& path, const TableHeader& expected, Func generator, bool check_elements) {
+            try {
+                MappedTable existing(path, expected);
+                if(!check_elements || existing.verify())
+                    return existing;
+            }
+            catch(const std::runtime_error& e) {}
+            write_table(path, expected, generator);
+            return MappedTable(path, expected);
+        }
+
+        inline const TableHeader& getHeader() const {
+            return *this->header;
+        }
+
+        inline size_t size() const {
+            return this->header->count;
+        }
+
+        //Recomputes the checksum of the element data, this reads the entire table
+        bool verify() const {
+            return table_checksum(this->data, this->header->count * this->header->element_width) == this->header->checksum;
+        }
+
+        inline size_t operator[](size_t index) const {
+            return read_table_element(this->data, this->header->element_width, index);
+        }
+};
+
+//Process-wide cache of mapped tables in a directory, so a table used by several threads at once is only opened once
+//The cache only holds weak references, a table is unmapped as soon as the last trial using it finishes.
+//An existing file is verified against its checksum the first time the process maps it, later maps only check its header
+//Safe to use from multiple threads, tables are generated outside the lock so independent tables can be written in parallel
+class TableCache {
+    private:
+        std::string directory;
+        std::mutex mutex;
+        std::map<std::string, std::weak_ptr<const MappedTable>> tables;
+        //Paths of the tables verified or written by this process
+        std::set<std::string> verified;
+    public:
+        explicit TableCache(const std::string& directory) : directory(directory) {}
+
+        //Returns the table described by header, opening or generating it on first use
+        template <typename Func>
+        std::shared_ptr<const MappedTable> get(const TableHeader& header, Func generator) {
+            std::string path = table_path(this->directory, header);
+            bool check_elements;
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                auto found = this->tables.find(path);
+                if(found != this->tables.end())
+                    if(std::shared_ptr<const MappedTable> table = found->second.lock())
+                        return table;
+                check_elements = this->verified.count(path) == 0;
+            }
+
+            std::shared_ptr<const MappedTable> table = std::make_shared<MappedTable>(MappedTable::openOrCreate(path, header, generator, check_elements));
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->verified.insert(path);
+            //Drop the entries of released tables, so the cache does not grow with the number of trials
+            for(auto entry = this->tables.begin(); entry != this->tables.end();)
+                entry = entry->second.expired() ? this->tables.erase(entry) : std::next(entry);
+            std::weak_ptr<const MappedTable>& entry = this->tables[path];
+            if(std::shared_ptr<const MappedTable> existing = entry.lock())
+                return existing;
+            entry = table;
+            return table;
+        }
+};
+
+//Function object evaluating a function through its table
+struct TableFunction {
+    std::shared_ptr<const MappedTable> table;
+
+    inline size_t operator()(size_t input) const {
+        return (*this->table)[input];
+    }
+};
+
+#endif
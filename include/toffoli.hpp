@@ -3,11 +3,16 @@
 
 //Utility functions for creating toffoli-based constructions
 
+#include <algorithm>
 #include <array>
 #include <cstdarg>
 #include <iostream>
+#include <type_traits>
+#include <utility>
 
+#include "instrument.hpp"
 #include "quantum.hpp"
+#include "register.hpp"
 
 //Creates an n-bit toffoli, using the args register to denote which bits to include in the toffoli, and using target_bit as the target
 //This function is used internally by create_nbit_toffoli to expand the argument list into a compile time list of arguments
@@ -19,9 +24,59 @@ void create_nbit_toffoli_internal(std::index_sequence<Args...>, quantum_reg* tar
 //Creates an n-bit toffoli, using the args register to denote which bits to include in the toffoli, and using target_bit as the target
 template <size_t N>
 void create_nbit_toffoli(quantum_reg* target_register, size_t target_bit, const std::array<size_t, N>& args) {
+    QA_COUNT(ToffoliGates, 1);
     create_nbit_toffoli_internal<N>(std::make_index_sequence<N>(), target_register, target_bit, args);
 }
 
+//Creates an n-bit toffoli on one of our own register types, which take the list of control bits directly
+template <size_t N, typename Reg>
+void create_nbit_toffoli(Reg* target_register, size_t target_bit, const std::array<size_t, N>& args) {
+    QA_COUNT(ToffoliGates, 1);
+    target_register->toffoli(args.data(), N, target_bit);
+}
+
+//Creates an n-bit toffoli on a libquantum register from a control list of length Count, a toffoli without controls is ignored
+template <size_t Count>
+void create_nbit_toffoli_array(quantum_reg* target_register, size_t target_bit, const size_t* controls) {
+    if constexpr(Count == 0) {
+        ((void)target_register);
+        ((void)target_bit);
+        ((void)controls);
+    }
+    else {
+        std::array<size_t, Count> args;
+        std::copy(controls, controls + Count, args.begin());
+        create_nbit_toffoli<Count>(target_register, target_bit, args);
+    }
+}
+
+//Lookup table of create_nbit_toffoli_array, indexed by the number of controls
+template <size_t... Counts>
+struct ToffoliCountTable {
+    static constexpr void (*callbacks[])(quantum_reg*, size_t, const size_t*) = {
+        &create_nbit_toffoli_array<Counts>...
+    };
+};
+
+template <size_t... Counts>
+inline void create_nbit_toffoli_runtime_internal(std::index_sequence<Counts...>, quantum_reg* target_register, size_t target_bit, const size_t* controls, size_t count) {
+    ToffoliCountTable<Counts...>::callbacks[count](target_register, target_bit, controls);
+}
+
+//Creates an n-bit toffoli with a number of controls chosen at run time, which has to be at most MaxControls
+//Our own register types take the control list directly. libquantum only offers a variadic gate, so its registers go through a table of
+//MaxControls + 1 instances of create_nbit_toffoli, one per number of controls
+template <size_t MaxControls, typename Reg>
+void create_nbit_toffoli_runtime(Reg* target_register, size_t target_bit, const size_t* controls, size_t count) {
+    if constexpr(std::is_same_v<Reg, quantum_reg>) {
+        create_nbit_toffoli_runtime_internal(std::make_index_sequence<MaxControls + 1>(), target_register, target_bit, controls, count);
+    }
+    else if(count != 0) {
+        QA_COUNT(ToffoliGates, 1);
+        target_register->toffoli(controls, count, target_bit);
+    }
+}
+
 //Calculates the number of bits set in a given mask
 template <size_t N>
 constexpr size_t num_bits_set(size_t mask) {
@@ -35,8 +90,8 @@ constexpr size_t num_bits_set(size_t mask) {
 
 //Creates a toffoli-construction, using the Mask parameter to determine which bits to include in the toffoli
 //For internal use by create_masked_toffoli_base, used to expand the template parameter denoting the number of bits set in the mask
-template <size_t N, size_t Set, size_t Mask>
-void create_masked_toffoli_internal(quantum_reg* target_register, size_t target_bit, size_t offset) {
+template <size_t N, size_t Set, size_t Mask, typename Reg>
+void create_masked_toffoli_internal(Reg* target_register, size_t target_bit, size_t offset) {
     std::array<size_t, Set> content = {0};
     size_t set_bits = 0;
     for(size_t j = 0; j < N; ++j) {
@@ -49,14 +104,14 @@ void create_masked_toffoli_internal(quantum_reg* target_register, size_t target_
 //Creates a toffoli-construction, using the Mask parameter to deterime which bits to include in the toffoli
 //This function is for internal use by create_masked_toffoli
 //This function cannot handle cases where Mask == 0, which are handled by create_masked_toffoli
-template <size_t N, size_t Mask>
-inline void create_masked_toffoli_base(quantum_reg* target_register, size_t target_bit, size_t offset) {
+template <size_t N, size_t Mask, typename Reg>
+inline void create_masked_toffoli_base(Reg* target_register, size_t target_bit, size_t offset) {
     create_masked_toffoli_internal<N, num_bits_set<N>(Mask), Mask>(target_register, target_bit, offset);
 }
 
 //Creates a toffoli-construction, using the Mask paramter to determine which bits to include in the toffoli
-template <size_t N, size_t Mask>
-void create_masked_toffoli(quantum_reg* target_register, size_t target_bit, size_t offset) {
+template <size_t N, size_t Mask, typename Reg>
+void create_masked_toffoli(Reg* target_register, size_t target_bit, size_t offset) {
     if constexpr(Mask == 0) {
         ((void)target_register);
         ((void)target_bit);
@@ -67,37 +122,52 @@ void create_masked_toffoli(quantum_reg* target_register, size_t target_bit, size
     }
 }
 
+//Largest N for which create_masked_toffoli_runtime uses the lookup table of all 2^N masks, larger N collect the controls at run time
+constexpr size_t TOFFOLI_MASK_TABLE_MAX_BITS = 4;
+
 //Type defintions for the toffoli creation lookup table defined below
-using toffoli_create_callback = void(quantum_reg*, size_t, size_t);
+template <typename Reg>
+using toffoli_create_callback = void(Reg*, size_t, size_t);
 
 //Utility structure to create pointers to functions generate toffoli functions from given bitmasks
-template <size_t N, size_t Mask>
+template <size_t N, size_t Mask, typename Reg>
 struct ToffoliCallbackGenerator {
-    const static constexpr toffoli_create_callback* callback = &create_masked_toffoli<N, Mask>;
+    const static constexpr toffoli_create_callback<Reg>* callback = &create_masked_toffoli<N, Mask, Reg>;
 };
 
 //Generates a lookup table of toffoli creation routines, where callback i creates the masked-toffoli callback defined by Mask parameter i
-template <size_t N, size_t... Masks>
+template <size_t N, typename Reg, size_t... Masks>
 struct ToffoliSequenceGenerator {
-    const static constexpr toffoli_create_callback* callbacks[] = {
-        ToffoliCallbackGenerator<N, Masks>::callback...
+    const static constexpr toffoli_create_callback<Reg>* callbacks[] = {
+        ToffoliCallbackGenerator<N, Masks, Reg>::callback...
     };
 };
 
 //Creates a toffoli-construction using a mask provided to it at runtime
 //Uses the compile-time generated toffoli-creation lookup table to call the toffoli-creation routine which creates the toffoli with the given mask
 //For internal use by create_masked_toffoli_runtime
-template <size_t N, size_t... Masks>
-inline void create_masked_toffoli_runtime_internal(std::index_sequence<Masks...>, size_t mask, quantum_reg* target_register, size_t target_bit, size_t offset) {
-    ToffoliSequenceGenerator<N, Masks...>::callbacks[mask](target_register, target_bit, offset);
+template <size_t N, typename Reg, size_t... Masks>
+inline void create_masked_toffoli_runtime_internal(std::index_sequence<Masks...>, size_t mask, Reg* target_register, size_t target_bit, size_t offset) {
+    ToffoliSequenceGenerator<N, Reg, Masks...>::callbacks[mask](target_register, target_bit, offset);
 }
 
 //Creates a toffoli gate, where every bit in mask defines whether to include the bit as a source operand in the toffoli
 //The target_bit paramter denotes the bit to write toggle
 //The offset parameter defines from which bit to start generating the mask (e.g. offset = 2, mask = 5) would create a toffoli involving bits 2 and 4
-template <size_t N>
-inline void create_masked_toffoli_runtime(size_t mask, quantum_reg* target_register, size_t target_bit, size_t offset) {
-    create_masked_toffoli_runtime_internal<N>(std::make_index_sequence<1ull << N>(), mask, target_register, target_bit, offset);
+//The lookup table instantiates create_masked_toffoli for all 2^N masks, so it is only used for tiny N. Otherwise the set bits of the mask
+//are collected into a fixed buffer, and applied as a single gate with a run time number of controls
+template <size_t N, typename Reg>
+inline void create_masked_toffoli_runtime(size_t mask, Reg* target_register, size_t target_bit, size_t offset) {
+    if constexpr(N <= TOFFOLI_MASK_TABLE_MAX_BITS) {
+        create_masked_toffoli_runtime_internal<N, Reg>(std::make_index_sequence<1ull << N>(), mask, target_register, target_bit, offset);
+    }
+    else {
+        std::array<size_t, N> controls;
+        size_t count = 0;
+        for(size_t remaining = mask; remaining != 0; remaining &= remaining - 1)
+            controls[count++] = __builtin_ctzll(remaining) + offset;
+        create_nbit_toffoli_runtime<N>(target_register, target_bit, controls.data(), count);
+    }
 }
 
 #endif
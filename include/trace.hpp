@@ -0,0 +1,152 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_TRACE
+#define QUANTUM_CRYPTO_ATTACK_TRACE
+
+//Optional timeline tracing of the attack pipeline, written as a Chrome trace event file (chrome://tracing, ui.perfetto.dev)
+//Only compiled in when QA_TRACE is defined (make TRACE=1), otherwise QA_TRACE_SCOPE expands to nothing.
+//At run time events are only recorded when the QA_TRACE_JSON environment variable names the output file, which is written at exit.
+//Every thread records into its own fixed-size ring buffer, which keeps the most recent events once it is full
+
+#ifdef QA_TRACE
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//A finished scope, recorded as a single complete event holding both its begin and end time
+struct TraceEvent {
+    //Static strings, only the pointers are stored
+    const char* name;
+    const char* category;
+    //Begin and duration in nanoseconds since the start of the trace
+    uint64_t begin;
+    uint64_t duration;
+    //Optional argument shown with the event, such as a trial id, UINT64_MAX when absent
+    uint64_t argument;
+};
+
+//Ring buffer of the events of a single thread
+struct TraceBuffer {
+    uint32_t thread;
+    //Number of events recorded so far, the buffer holds the last min(recorded, capacity) of them
+    uint64_t recorded;
+    std::vector<TraceEvent> events;
+
+    TraceBuffer(uint32_t thread, size_t capacity) : thread(thread), recorded(0), events(capacity) {}
+
+    inline void add(const TraceEvent& event) {
+        this->events[this->recorded++ % this->events.size()] = event;
+    }
+};
+
+//Owns the buffers of all threads, and writes the trace when the process exits
+class TraceRegistry {
+    private:
+        //Events kept per thread
+        static constexpr size_t CAPACITY = 1 << 18;
+
+        std::mutex mutex;
+        std::vector<std::unique_ptr<TraceBuffer>> buffers;
+        const char* path;
+        std::chrono::steady_clock::time_point start;
+
+        TraceRegistry() : path(std::getenv("QA_TRACE_JSON")), start(std::chrono::steady_clock::now()) {}
+
+        void write(FILE* out) {
+            std::fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+            bool first = true;
+            for(const std::unique_ptr<TraceBuffer>& buffer : this->buffers) {
+                std::fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                    first ? "" : ",\n", buffer->thread, buffer->thread);
+                first = false;
+
+                size_t kept = std::min<uint64_t>(buffer->recorded, buffer->events.size());
+                for(uint64_t i = buffer->recorded - kept; i < buffer->recorded; ++i) {
+                    const TraceEvent& event = buffer->events[i % buffer->events.size()];
+                    std::fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                        event.name, event.category, buffer->thread, event.begin * 1e-3, event.duration * 1e-3);
+                    if(event.argument != UINT64_MAX)
+                        std::fprintf(out, ",\"args\":{\"value\":%llu}", (unsigned long long) event.argument);
+                    std::fprintf(out, "}");
+                }
+            }
+            std::fprintf(out, "\n]}\n");
+        }
+    public:
+        static TraceRegistry& get() {
+            static TraceRegistry registry;
+            return registry;
+        }
+
+        ~TraceRegistry() {
+            if(this->path == nullptr)
+                return;
+            FILE* file = std::fopen(this->path, "w");
+            if(file == nullptr) {
+                std::fprintf(stderr, "Could not write trace file %s\n", this->path);
+                return;
+            }
+            this->write(file);
+            std::fclose(file);
+        }
+
+        inline bool enabled() const {
+            return this->path != nullptr;
+        }
+
+        //Nanoseconds since the start of the trace
+        inline uint64_t now() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->start).count();
+        }
+
+        TraceBuffer* add() {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->buffers.emplace_back(new TraceBuffer(this->buffers.size(), CAPACITY));
+            return this->buffers.back().get();
+        }
+};
+
+//Buffer of the calling thread, created on first use
+inline TraceBuffer& trace_buffer() {
+    static TraceRegistry& registry = TraceRegistry::get();
+    thread_local TraceBuffer* buffer = registry.add();
+    return *buffer;
+}
+
+//Records its scope as an event, when tracing is enabled
+class TraceScope {
+    private:
+        const char* name;
+        const char* category;
+        uint64_t argument;
+        uint64_t begin;
+    public:
+        TraceScope(const char* category, const char* name, uint64_t argument = UINT64_MAX) : name(name), category(category), argument(argument), begin(0) {
+            if(TraceRegistry::get().enabled())
+                this->begin = TraceRegistry::get().now();
+        }
+
+        ~TraceScope() {
+            TraceRegistry& registry = TraceRegistry::get();
+            if(registry.enabled())
+                trace_buffer().add({this->name, this->category, this->begin, registry.now() - this->begin, this->argument});
+        }
+};
+
+#define QA_TRACE_CONCAT_INNER(a, b) a##b
+#define QA_TRACE_CONCAT(a, b) QA_TRACE_CONCAT_INNER(a, b)
+
+//Records the rest of the enclosing scope as an event, optionally with a numeric argument
+#define QA_TRACE_SCOPE(category, ...) TraceScope QA_TRACE_CONCAT(trace_scope_, __LINE__)(category, __VA_ARGS__)
+
+#else
+
+#define QA_TRACE_SCOPE(category, ...) ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,302 @@
+#ifndef QUANTUM_CRYPTO_ATTACK_TRIALS
+#define QUANTUM_CRYPTO_ATTACK_TRIALS
+
+//Monte Carlo runner measuring the accuracy of the feistel detection over many independent trials
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <vector>
+
+#include "circuit.hpp"
+#include "decompose.hpp"
+#include "detect.hpp"
+#include "feistel.hpp"
+#include "feistel_oracle.hpp"
+#include "permutation.hpp"
+#include "pool.hpp"
+#include "random.hpp"
+#include "table.hpp"
+#include "trace.hpp"
+
+//Kind of function a trial runs the detection on
+enum class TrialKind {
+    Feistel,
+    Random
+};
+
+//Trials alternate between both kinds, so the first n trials of a run are the same regardless of the total number of trials
+//Even trial ids run on feistel networks, odd trial ids on random permutations
+inline TrialKind trial_kind(size_t trial) {
+    return trial & 1 ? TrialKind::Random : TrialKind::Feistel;
+}
+
+//Selects the kinds of functions a batch of trials runs on
+enum class TrialSelection {
+    Feistel,
+    Random,
+    Both
+};
+
+//Selects how the circuits of the feistel trials build the oracle of the f function
+//Random permutations have no structure to compile, their trials always use the truth table oracle
+enum class OracleKind {
+    //Enumerates the truth table of f, see bitflip_oracle
+    Table,
+    //Compiles the feistel network round by round, see FeistelOracle
+    Feistel
+};
+
+//Configuration of a batch of trials
+struct TrialConfig {
+    //Number of trials for every selected kind of function
+    size_t trials;
+    uint64_t seed;
+    Backend backend;
+    //Number of rounds of the feistel networks
+    size_t rounds;
+    TrialSelection selection;
+    //Width of the S-boxes of the SPN round function, at most the number of bits, see feistel_sbox_width
+    size_t sbox_width;
+    OracleKind oracle;
+    ToffoliDecomposition decomposition;
+    //Whether oracles are recorded and optimised once per detection, see CachedOracle
+    bool cache_circuits;
+
+    //Number of trials in the batch
+    inline size_t count() const {
+        return this->selection == TrialSelection::Both ? 2 * this->trials : this->trials;
+    }
+
+    //Trial id of the index-th trial in the batch
+    inline size_t trialId(size_t index) const {
+        switch(this->selection) {
+            case TrialSelection::Feistel:
+                return 2 * index;
+            case TrialSelection::Random:
+                return 2 * index + 1;
+            default:
+                return index;
+        }
+    }
+};
+
+//Result of a single trial
+struct TrialResult {
+    size_t trial;
+    TrialKind kind;
+    DetectionResult detection;
+    //Wall time of the trial, including the construction of its function
+    double seconds;
+};
+
+//Aggregated results of a batch of trials
+struct TrialSummary {
+    size_t feistel_trials;
+    //Feistel trials classified as feistel network
+    size_t feistel_detected;
+    size_t random_trials;
+    //Random trials classified as feistel network
+    size_t random_detected;
+    size_t total_queries;
+    size_t total_inconsistent;
+    //Time spent in every phase of the detections, summed over all trials
+    DetectionTimings total_timings;
+    //Sum, minimum and maximum of the per-trial wall times
+    double total_seconds;
+    double min_seconds;
+    double max_seconds;
+    //Wall time of the whole batch
+    double wall_seconds;
+
+    inline double truePositiveRate() const {
+        return this->feistel_trials ? double(this->feistel_detected) / this->feistel_trials : 0;
+    }
+
+    inline double falsePositiveRate() const {
+        return this->random_trials ? double(this->random_detected) / this->random_trials : 0;
+    }
+
+    inline size_t trials() const {
+        return this->feistel_trials + this->random_trials;
+    }
+
+    inline double meanQueries() const {
+        return this->trials() ? double(this->total_queries) / this->trials() : 0;
+    }
+
+    inline double meanSeconds() const {
+        return this->trials() ? this->total_seconds / this->trials() : 0;
+    }
+};
+
+//Aggregates the results of a batch of trials
+inline TrialSummary summarize_trials(const std::vector<TrialResult>& results, double wall_seconds) {
+    TrialSummary summary = {0, 0, 0, 0, 0, 0, {0, 0, 0, 0}, 0, 0, 0, wall_seconds};
+    for(const TrialResult& result : results) {
+        bool feistel = is_feistel(result.detection.verdict);
+        if(result.kind == TrialKind::Feistel) {
+            ++summary.feistel_trials;
+            summary.feistel_detected += feistel;
+        }
+        else {
+            ++summary.random_trials;
+            summary.random_detected += feistel;
+        }
+        summary.total_queries += result.detection.queries;
+        summary.total_inconsistent += result.detection.inconsistent;
+        summary.total_timings.setup += result.detection.timings.setup;
+        summary.total_timings.simon += result.detection.timings.simon;
+        summary.total_timings.solve += result.detection.timings.solve;
+        summary.total_timings.verify += result.detection.timings.verify;
+        summary.min_seconds = summary.trials() == 1 ? result.seconds : std::min(summary.min_seconds, result.seconds);
+        summary.max_seconds = std::max(summary.max_seconds, result.seconds);
+        summary.total_seconds += result.seconds;
+    }
+    return summary;
+}
+
+//Width of the S-boxes of the round function for the given number of bits, a width of 0 selects a single S-box over all bits
+inline size_t feistel_sbox_width(size_t bits, size_t width) {
+    return width == 0 || width > bits ? bits : width;
+}
+
+//Generates the S-box of the feistel round function, a minimal version of Pearson hashing, over width bits
+//The S-box only depends on the experiment seed, and is shared by all trials like the public components of a real cipher
+inline std::unique_ptr<size_t[]> make_feistel_sbox(size_t width, uint64_t seed) {
+    RandomStream cipher_rng = TrialSeed{seed, 0}.stream(RandomStreamId::Cipher);
+    return std::unique_ptr<size_t[]>(generate_permuation_map(1ull << width, 100000, cipher_rng));
+}
+
+//Draws the fresh round keys of a feistel trial from the key stream of the trial
+template <size_t Bits>
+std::vector<size_t> make_trial_keys(const TrialSeed& trial_seed, size_t rounds) {
+    RandomStream key_rng = trial_seed.stream(RandomStreamId::Keys);
+    std::vector<size_t> keys(rounds);
+    for(size_t i = 0; i < rounds; ++i)
+        keys[i] = key_rng.uniform(1ull << Bits);
+    return keys;
+}
+
+//Builds the feistel network of a feistel trial, with an SPN round function using the given S-box and fresh round keys
+template <size_t Bits>
+auto make_trial_feistel(const TrialSeed& trial_seed, const size_t* sbox, size_t sbox_width, size_t rounds) {
+    return make_feistel_encrypt<Bits>(SpnRoundFunction<Bits>{sbox, sbox_width}, make_trial_keys<Bits>(trial_seed, rounds));
+}
+
+//Number of elements of the table of the f function of a trial, see run_trial_detect
+inline size_t trial_table_count(size_t bits) {
+    return 1ull << (bits + 1);
+}
+
+//Size in bytes of the table file of the f function of a trial
+inline size_t trial_table_bytes(size_t bits) {
+    return sizeof(TableHeader) + trial_table_count(bits) * table_element_width(bits);
+}
+
+//Builds the structured oracles of the f functions of a feistel trial, see FeistelOracle
+template <size_t Bits>
+struct FeistelOracleFactory {
+    const size_t* sbox;
+    size_t sbox_width;
+    std::vector<size_t> keys;
+
+    template <typename Func>
+    FeistelOracle<Bits> operator()(Func, const DetectionParameters& parameters) const {
+        return {this->sbox, this->sbox_width, this->keys, parameters.alpha, parameters.beta};
+    }
+};
+
+//Runs the detection on the function of a trial, through the table of its f function in tables when a table cache is given
+//Only f is tabulated, the detection never evaluates the attacked function outside of f, so a table has 2^(Bits+1) elements of Bits bits.
+//The oracles of the factory are decomposed as selected by the configuration, and recorded into optimised circuits when caching is enabled
+template <size_t Bits, typename Func, typename OracleFactory>
+DetectionResult run_trial_detect(Func function, OracleFactory make_oracle, TableCipher cipher, size_t rounds, const TrialSeed& trial_seed, const TrialConfig& config, TableCache* tables) {
+    return dispatch_decomposition<Bits + 1>(config.decomposition, make_oracle, [&](auto decomposed) {
+        CachingOracleFactory<decltype(decomposed)> cached = {decomposed, config.cache_circuits};
+        DetectionParameters parameters = draw_detection_parameters<Bits>(trial_seed);
+        auto f = make_detection_function<Bits>(function, parameters);
+        if(tables == nullptr)
+            return run_detection<Bits>(f, parameters, cached, trial_seed, config.backend);
+
+        size_t sbox_width = cipher == TableCipher::Feistel ? config.sbox_width : 0;
+        TableHeader header = make_table_header(cipher, Bits, rounds, sbox_width, trial_seed.seed, trial_seed.trial, Bits, trial_table_count(Bits));
+        return run_detection<Bits>(TableFunction{tables->get(header, f)}, parameters, cached, trial_seed, config.backend);
+    });
+}
+
+//Runs a single trial, building a feistel network with fresh round keys or a fresh random permutation, and detecting it
+template <size_t Bits>
+TrialResult run_trial(size_t trial, const size_t* sbox, const TrialConfig& config, TableCache* tables) {
+    QA_TRACE_SCOPE("trial", trial_kind(trial) == TrialKind::Feistel ? "feistel-trial" : "random-trial", trial);
+    auto start = std::chrono::steady_clock::now();
+
+    TrialSeed trial_seed = {config.seed, trial};
+
+    TrialResult result;
+    result.trial = trial;
+    result.kind = trial_kind(trial);
+    if(result.kind == TrialKind::Feistel) {
+        std::vector<size_t> keys = make_trial_keys<Bits>(trial_seed, config.rounds);
+        auto feistel = make_feistel_encrypt<Bits>(SpnRoundFunction<Bits>{sbox, config.sbox_width}, keys);
+        if(config.oracle == OracleKind::Feistel) {
+            FeistelOracleFactory<Bits> make_oracle = {sbox, config.sbox_width, keys};
+            result.detection = run_trial_detect<Bits>(feistel, make_oracle, TableCipher::Feistel, config.rounds, trial_seed, config, tables);
+        }
+        else {
+            result.detection = run_trial_detect<Bits>(feistel, TableOracleFactory<Bits>(), TableCipher::Feistel, config.rounds, trial_seed, config, tables);
+        }
+    }
+    else {
+        RandomStream key_rng = trial_seed.stream(RandomStreamId::Keys);
+        RandomPermutation permutation = RandomPermutation::ofWidth(2 * Bits, key_rng());
+        result.detection = run_trial_detect<Bits>(permutation, TableOracleFactory<Bits>(), TableCipher::RandomPermutation, 0, trial_seed, config, tables);
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+//Runs the trials of a batch as independent detections on the given thread pool, and returns their results ordered by trial id
+//Every trial only depends on its own random streams, so the results do not depend on the number of threads.
+//The sbox has to be created by make_feistel_sbox for the same seed and S-box width, the table cache is optional.
+//Every finished trial is passed to observer(worker, index, result) on the worker that ran it, in completion order.
+//Trials for which restore(index, result) returns true are not run again, the result filled in by restore is used instead
+template <size_t Bits, typename Observer, typename Restore>
+std::vector<TrialResult> run_trials(const TrialConfig& config, const size_t* sbox, ThreadPool& pool, TableCache* tables, Observer observer, Restore restore) {
+    std::vector<TrialResult> results(config.count());
+    //Errors of a trial, such as an unwritable table directory, are rethrown on the calling thread once all trials have finished
+    std::vector<std::exception_ptr> errors(config.count());
+    for(size_t index = 0; index < results.size(); ++index) {
+        pool.submit([&, index](size_t worker) {
+            try {
+                if(!restore(index, results[index]))
+                    results[index] = run_trial<Bits>(config.trialId(index), sbox, config, tables);
+                observer(worker, index, results[index]);
+            }
+            catch(...) {
+                errors[index] = std::current_exception();
+            }
+        });
+    }
+    pool.wait();
+    for(const std::exception_ptr& error : errors) {
+        if(error)
+            std::rethrow_exception(error);
+    }
+    return results;
+}
+
+template <size_t Bits, typename Observer>
+std::vector<TrialResult> run_trials(const TrialConfig& config, const size_t* sbox, ThreadPool& pool, TableCache* tables, Observer observer) {
+    return run_trials<Bits>(config, sbox, pool, tables, observer, [](size_t, TrialResult&) { return false; });
+}
+
+template <size_t Bits>
+std::vector<TrialResult> run_trials(const TrialConfig& config, const size_t* sbox, ThreadPool& pool, TableCache* tables) {
+    return run_trials<Bits>(config, sbox, pool, tables, [](size_t, size_t, const TrialResult&) {});
+}
+
+#endif
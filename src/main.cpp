@@ -1,64 +1,39 @@
 #include "quantum.hpp"
 
+#include <algorithm>
 #include <cstdlib>
-#include <ctime>
 #include <bitset>
+#include <chrono>
+#include <fstream>
 #include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
 
-#include "toffoli.hpp"
 #include "simon.hpp"
-#include "matrix.hpp"
+#include "checkpoint.hpp"
+#include "circuit.hpp"
+#include "oracle.hpp"
 #include "feistel.hpp"
-
-//Creates a quantum gate that toggles a given target bit if bits [offset, offset+N) match value
-template <size_t N>
-void create_toggle_if_match(size_t value, quantum_reg* x, size_t target, size_t offset) {
-    //Flip all bits that are 0 in the orignal value
-    //This would cause the register to contain all ones if and only if the value in the register equals value
-    for(size_t i = 0; i < N; ++i) {
-        if(!(value & (1ull << i))) {
-            quantum_sigma_x(offset + i, x);
-        }
-    }
-
-    //Use an n-bit toffoli on all N bits, setting the target bit if they are all one
-    create_masked_toffoli_runtime<N>((1ull << N) - 1, x, target, offset);
-
-    //Cleanup the flipped bits
-    for(size_t i = 0; i < N; ++i) {
-        if(!(value & (1ull << i))) {
-            quantum_sigma_x(offset + i, x);
-        }
-    }
-}
-
-//Convert a classical function into a bitflip oracle
-template <size_t N, size_t M, typename T>
-void bitflip_oracle(quantum_reg* x_y, T function) {
-    //Evaluate all possible inputs to the function, and calculate their results
-    size_t num_posibilities = (1ull << N);
-    for(size_t i = 0; i < num_posibilities; ++i) {
-        //Calculate the input to the i-th possible input to the function
-        size_t result = function(i);
-        
-        //For every bit which equals 1 in the output, flip it if and only if the value in the quantum register matches the input i to the function
-        for(size_t j = 0; j < M; ++j) {
-            if(result & (1ull << j))
-                create_toggle_if_match<N>(i, x_y, j+N, 0);
-        }
-    }
-}
-
-//Utility function to create a new function f(quantum_reg)
-//This function f(quantum_reg) performs a quantum bitflip oracle matching the classical callback function given as a parameter
-template <size_t N, size_t M, typename T>
-auto bind_to_bitflip_oracle(T callback) {
-    return std::bind(bitflip_oracle<N, M, T>, std::placeholders::_1, callback);
-}
-
+#include "feistel_oracle.hpp"
+#include "detect.hpp"
+#include "dispatch.hpp"
+#include "native.hpp"
+#include "options.hpp"
+#include "permutation.hpp"
+#include "qasm.hpp"
+#include "pool.hpp"
+#include "random.hpp"
+#include "report.hpp"
+#include "sampler.hpp"
+#include "sink.hpp"
+#include "table.hpp"
+#include "trials.hpp"
 
 //Simple test to see whether our Simon implementation only yields strings y satifying y * s = 0
-void test_simon() {
+void test_simon(uint64_t seed, Backend backend) {
     //Secret string for this function is 110
     size_t s = 6;
     //A valid 2-to-1 function with secret string s
@@ -86,9 +61,13 @@ void test_simon() {
 
     //Run simon's algorithm often, verify that the result measured in the first register matches the criteria
     auto oracle = bind_to_bitflip_oracle<3, 3>(function);
+    std::optional<SimonSampler<3, 3>> sampler;
+    if(backend == Backend::Sampler)
+        sampler.emplace(function);
+    RandomStream measurement_rng(seed, 0, RandomStreamId::Measurement);
     for(size_t i = 0; i < 100000; ++i) {
         //Run the quantum circuit and measure
-        std::pair<size_t, size_t> measurements = run_simon<3, 3>(oracle);
+        std::pair<size_t, size_t> measurements = query_simon<3, 3>(backend, oracle, sampler ? &*sampler : nullptr, measurement_rng);
         size_t measure_x = measurements.first;
 
         //Calculate s*x (mod 2), with s the secret string and x the measured register
@@ -110,9 +89,10 @@ void test_simon() {
 }
 
 //Classical function to test if our feister encrypt and decrypt routines are fuctional
-void run_feistel_classic_test() {
+void run_feistel_classic_test(uint64_t seed) {
     //Encrypt a random input
-    size_t input = rand() % 256;
+    RandomStream rng(seed, 0, RandomStreamId::Keys);
+    size_t input = rng.uniform(256);
 
     //The round function used for this test, flips the 2 bit pairs in the 4-bit input, and xors the bottom bits with the key
     auto round_function = [=](size_t input, size_t key) {
@@ -132,136 +112,328 @@ void run_feistel_classic_test() {
     std::cout << "Decrypted: " << decrypted << std::endl;
 }
 
-//Runs the feistel detection quantum algorithm as described in section 3 of the paper
-//The parameter denotes the function to verify
-template <size_t Bits, typename Func>
-void run_feistel_detect(Func internal_callback) {
-    //Generate random alpha and beta parameters
-    const size_t ALPHA = std::rand() % (1ull << Bits);
-    const size_t BETA = std::rand() % (1ull << Bits);
-
-    //Generate the f function matching our callback function, using the generated alpha and beta parameters
-    auto function = [=](size_t input) {
-        return run_f<Bits>(input,
-            internal_callback,
-            ALPHA,
-            BETA
-        );
+//Runs one batch of detection trials for a single point of the sweep, and prints the aggregated accuracy
+//When a sink is given, every trial is also streamed to it, with sequence numbers starting at sequence.
+//When a checkpoint is given, trials it already holds are restored instead of run, and every finished trial is added to it
+template <size_t BITS>
+void run_sweep_point(const TrialConfig& config, const size_t* sbox, ThreadPool& pool, TableCache* tables, ResultSink* sink, Checkpoint* checkpoint, uint64_t sequence, bool verbose) {
+    auto start = std::chrono::steady_clock::now();
+    auto observer = [&](size_t worker, size_t index, const TrialResult& result) {
+        TrialRecord record = make_trial_record(sequence + index, BITS, config, result);
+        if(sink != nullptr)
+            sink->push(worker, record);
+        if(checkpoint != nullptr)
+            checkpoint->add(record);
     };
+    auto restore = [&](size_t index, TrialResult& result) {
+        TrialRecord record;
+        if(checkpoint == nullptr || !checkpoint->find(sequence + index, record))
+            return false;
+        result = trial_result_of(record);
+        return true;
+    };
+    std::vector<TrialResult> results = run_trials<BITS>(config, sbox, pool, tables, observer, restore);
+    if(checkpoint != nullptr)
+        checkpoint->save();
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if(verbose) {
+        for(const TrialResult& result : results) {
+            std::cout << "Trial " << result.trial << " (" << kind_name(result.kind) << "): ";
+            print_detection_result(std::cout, result.detection, verbose);
+        }
+    }
+    print_trial_summary(std::cout, summarize_trials(results, wall_seconds), pool.size());
+}
 
-    //Create the bitflip oracle matching the f function
-    auto oracle = bind_to_bitflip_oracle<Bits + 1, Bits>(function);
-
-    MatrixSolver<Bits> solver;
-
-    //Attempt at most 2n runs of Simons algorithm
-    for(size_t i = 0; i < 2*Bits; ++i) {
-        try {
-            //Run simons algorithm
-            std::pair<size_t, size_t> measurements = run_simon<Bits + 1, Bits>(oracle);
-
-            //Obtain the observed result from the first register, and add it as a linear equation
-            size_t j = measurements.first;
-            solver.addRow(j);
-
-            //Check the number of linearly independent rows, if this equals n, start equation solving
-            size_t independent_rows = solver.getIndependent();
-            if(independent_rows == Bits) {
-                //Solve the equation
-                size_t s = solver.solveEncoded();
-
-                //Generate a random bitstring u
-                size_t u = std::rand() % (1ull << (Bits+1));
+//Calls visitor with the oracle of a query of the detection of the feistel network of trial 0, built as selected by the options
+//The table oracle is only instantiated for the sizes the simulation is built for, larger sizes need the structured oracle
+template <size_t BITS, typename Visitor>
+void visit_query_oracle(const ExperimentOptions& options, const size_t* sbox, size_t sbox_width, size_t rounds, Visitor visitor) {
+    TrialSeed trial_seed = {options.seed, 0};
+    std::vector<size_t> keys = make_trial_keys<BITS>(trial_seed, rounds);
+    DetectionParameters parameters = draw_detection_parameters<BITS>(trial_seed);
+    auto feistel = make_feistel_encrypt<BITS>(SpnRoundFunction<BITS>{sbox, sbox_width}, keys);
+    auto function = make_detection_function<BITS>(feistel, parameters);
+
+    auto visit = [&](auto make_oracle) {
+        dispatch_decomposition<BITS + 1>(options.decomposition, make_oracle, [&](auto decomposed) {
+            CachingOracleFactory<decltype(decomposed)> cached = {decomposed, options.cache_circuits};
+            visitor(cached(function, parameters));
+        });
+    };
+    if(options.oracle == OracleKind::Feistel)
+        visit(FeistelOracleFactory<BITS>{sbox, sbox_width, keys});
+    else if constexpr(BITS <= QA_MAX_BITS)
+        visit(TableOracleFactory<BITS>());
+}
 
-                //Check if f(u) == f(u ^ s), and draw conclusions
-                size_t f_u = function(u);
-                size_t f_u_s = function(u ^ s);
+//Estimates the resources of the detection circuit for the feistel network of trial 0, and prints them
+//With cache_circuits, the estimate counts the gates of the optimised circuit of the oracle, and the schedule of that circuit is printed
+template <size_t BITS>
+void run_resource_estimate(const ExperimentOptions& options, const size_t* sbox, size_t sbox_width, size_t rounds) {
+    visit_query_oracle<BITS>(options, sbox, sbox_width, rounds, [](auto oracle) {
+        print_resource_estimate(std::cout, estimate_simon_query<BITS + 1, BITS>(oracle), 2 * BITS);
+        if(oracle.circuit)
+            print_circuit_schedule(std::cout, *oracle.circuit);
+    });
+}
 
-                if(f_u == f_u_s) {
-                    std::cout << "3-round Feistel (solved equation)" << std::endl;
-                    return;
-                }
-                else {
-                    std::cout << "Random permutation" << std::endl;
-                    return;
-                }
-            }
-        }
-        catch(const std::runtime_error& e) {
-            //Skip invalid equations, note that this should not happen for valid Feistel networks
-            --i;
+//Writes the circuit of a query of the detection of the feistel network of trial 0 to an OpenQASM file, named by the prefix, bits and rounds
+template <size_t BITS>
+void run_qasm_export(const ExperimentOptions& options, const size_t* sbox, size_t sbox_width, size_t rounds) {
+    std::string path = options.qasm_prefix + "-w" + std::to_string(BITS) + "-r" + std::to_string(rounds) + ".qasm";
+    std::ofstream out(path);
+    if(!out)
+        throw std::runtime_error("Could not create OpenQASM file " + path);
+    //Circuits wider than CIRCUIT_MAX_QUBITS are written, but cannot be recorded or read back to check them
+    std::optional<Circuit> recorded;
+    visit_query_oracle<BITS>(options, sbox, sbox_width, rounds, [&](auto oracle) {
+        write_simon_qasm<BITS + 1, BITS>(out, oracle, options.qasm_version);
+        size_t width = 2 * BITS + 1 + oracle_ancillas(oracle);
+        if(width <= CIRCUIT_MAX_QUBITS) {
+            CircuitRecorder recorder(width);
+            run_simon_circuit<BITS + 1>(&recorder, oracle);
+            recorded = recorder.getCircuit();
         }
+    });
+    out.close();
+    if(!out)
+        throw std::runtime_error("Could not write OpenQASM file " + path);
+    if(!recorded) {
+        std::cout << "Wrote " << path << ", round trip not checked for more than " << CIRCUIT_MAX_QUBITS << " qubits" << std::endl;
+        return;
     }
-    //More than 2n equations tried, guess the function to be a feistel
-    std::cout << "3-round Feistel (more than 2n equations attempted)" << std::endl;
+
+    //Read the file back, and check that it describes the same query as the recorded circuit
+    std::ifstream in(path);
+    RandomStream rng = TrialSeed{options.seed, 0}.stream(RandomStreamId::Verification);
+    if(!simon_oracles_match<BITS + 1, BITS>(*recorded, read_qasm(in), rng, QASM_ROUND_TRIP_STATES))
+        throw std::runtime_error("OpenQASM file " + path + " does not match the recorded circuit");
+    std::cout << "Wrote " << path << ", round trip checked on " << QASM_ROUND_TRIP_STATES << " basis states" << std::endl;
 }
 
-//Generates a random permutation of integer values
-//This creates a lookup table where every integer between 0 and max appears once, at a random position in the table
-size_t* generate_permuation_map(size_t max, size_t permutations) {
-    size_t* permutation_map = new size_t[max];
-    for(size_t i = 0; i < max; ++i) {
-        permutation_map[i] = i;
-    }
+//Simulates a query of the detection of the feistel network of trial 0 in double and in single precision on the native backend,
+//with real amplitudes when the oracle is real like the backends do, and prints how far the single precision state deviates
+template <size_t BITS>
+void run_precision_comparison(const ExperimentOptions& options, const size_t* sbox, size_t sbox_width, size_t rounds) {
+    visit_query_oracle<BITS>(options, sbox, sbox_width, rounds, [](auto oracle) {
+        const size_t width = 2 * BITS + 1 + oracle_ancillas(oracle);
+        auto compare = [&](auto* reg, auto* single) {
+            run_simon_circuit<BITS + 1>(reg, oracle);
+            run_simon_circuit<BITS + 1>(single, oracle);
+            print_precision_comparison(std::cout, compare_registers(*reg, *single), width);
+        };
+        if(oracle_is_real(oracle)) {
+            RealNativeRegister reg(width);
+            RealNativeRegister32 single(width);
+            compare(&reg, &single);
+        } else {
+            NativeRegister reg(width);
+            NativeRegister32 single(width);
+            compare(&reg, &single);
+        }
+    });
+}
 
-    //Swap random elements
-    for(size_t i = 0; i < permutations; ++i) {
-        size_t x = std::rand() % max;
-        size_t y = std::rand() % max;
+//Runs the detection of the feistel network of trial 0 with the circuit of its queries imported from OpenQASM,
+//and with the circuit built as selected by the options, for comparison
+template <size_t BITS>
+void run_imported_detection(const ExperimentOptions& options, const Circuit& circuit, const size_t* sbox, size_t sbox_width, size_t rounds, Backend backend) {
+    TrialSeed trial_seed = {options.seed, 0};
+    std::vector<size_t> keys = make_trial_keys<BITS>(trial_seed, rounds);
+    auto feistel = make_feistel_encrypt<BITS>(SpnRoundFunction<BITS>{sbox, sbox_width}, keys);
+    CircuitOracle oracle = simon_oracle_of<BITS + 1, BITS>(circuit);
+    auto make_oracle = [&](auto, const DetectionParameters&) {
+        return oracle;
+    };
 
-        std::swap(permutation_map[x], permutation_map[y]);
-    }
+    std::cout << "Imported circuit: ";
+    print_detection_result(std::cout, run_feistel_detect<BITS>(feistel, make_oracle, trial_seed, backend), options.verbose);
+    TrialConfig config = {1, options.seed, backend, rounds, TrialSelection::Feistel, sbox_width, options.oracle, options.decomposition, options.cache_circuits};
+    std::cout << "Built-in circuit: ";
+    print_detection_result(std::cout, run_trial<BITS>(0, sbox, config, nullptr).detection, options.verbose);
+}
 
-    return permutation_map;
+//Number of bytes of the table files written by the detection trials of a run, see run_trial_detect
+//Feistel trials have a table per number of rounds, random trials one for all rounds, and the backends of a run share their tables
+uint64_t table_dir_bytes(const ExperimentOptions& options) {
+    auto runs = [&](ExperimentMode kind) {
+        return std::any_of(options.modes.begin(), options.modes.end(), [&](ExperimentMode mode) {
+            return mode == kind || mode == ExperimentMode::Both;
+        });
+    };
+    uint64_t tables = (runs(ExperimentMode::Feistel) ? options.rounds.size() : 0) + (runs(ExperimentMode::Random) ? 1 : 0);
+    uint64_t bytes = 0;
+    for(size_t bits : options.bits)
+        bytes += tables * options.trials * trial_table_bytes(bits);
+    return bytes;
 }
 
-//Test our feistel detection routines
-void run_feistel_tests() {
-    //Configuration for our oracles and functions
-    const size_t FEISTEL_ROUNDS = 3;
-    const size_t BITS = 8;
-
-    //Generates a random permutation map used for the Feistel subkey function
-    size_t* feistel_permutation_map = generate_permuation_map(1 << BITS, 100000);
-    //Generates a random permutation map used for the random swapping function
-    size_t* random_permutation_map = generate_permuation_map(1 << (2 * BITS), 100000);
-
-    //Generate the subkeys for the feistel rounds
-    std::array<size_t, FEISTEL_ROUNDS> keys;
-    for(size_t i = 0; i < FEISTEL_ROUNDS; ++i) {
-        keys[i] = std::rand() % (1ull << BITS);
+//Runs every experiment of the Cartesian product of the modes, backends, bits and rounds in options
+//The thread pool, the S-boxes, the table cache, the result sink and the checkpoint are shared by all sweep points
+void run_experiment(const ExperimentOptions& options) {
+    bool simulation_free = std::all_of(options.modes.begin(), options.modes.end(), [](ExperimentMode mode) {
+        return mode == ExperimentMode::Estimate || mode == ExperimentMode::Qasm;
+    });
+    size_t max_bits = simulation_free && options.oracle == OracleKind::Feistel ? QA_MAX_ESTIMATE_BITS : QA_MAX_BITS;
+    for(size_t bits : options.bits) {
+        if(bits < QA_MIN_BITS || bits > max_bits)
+            throw std::runtime_error("Unsupported number of bits: " + std::to_string(bits) + ", supported are " + std::to_string(QA_MIN_BITS) + " to " + std::to_string(max_bits));
+        if(feistel_sbox_width(bits, options.sbox_width) > FEISTEL_ORACLE_MAX_SBOX_WIDTH)
+            throw std::runtime_error("S-box width of " + std::to_string(bits) + " bits too large, at most " + std::to_string(FEISTEL_ORACLE_MAX_SBOX_WIDTH) + " are supported, see --sbox-width");
     }
 
-    //The round function to use, a minimal version of Pearshon hashing
-    auto round_function = [=](size_t input, size_t key) {
-        return feistel_permutation_map[(input ^ key)];
+    if(!options.table_dir.empty() && table_dir_bytes(options) > options.table_limit)
+        throw std::runtime_error("The table files of this run would take up " + std::to_string(table_dir_bytes(options)) + " bytes, more than the limit of "
+            + std::to_string(options.table_limit) + ", see --table-limit");
+
+    std::cout << "Seed: " << options.seed << std::endl;
+    ThreadPool pool(options.threads);
+    std::unique_ptr<TableCache> tables;
+    if(!options.table_dir.empty())
+        tables.reset(new TableCache(options.table_dir));
+    std::unique_ptr<ResultSink> sink;
+    if(!options.output.empty())
+        sink.reset(new ResultSink(options.output, options.format, pool.size()));
+    std::unique_ptr<Checkpoint> checkpoint;
+    if(!options.checkpoint.empty()) {
+        checkpoint.reset(new Checkpoint(options.checkpoint, experiment_fingerprint(options)));
+        if(checkpoint->size() > 0)
+            std::cout << "Resuming from checkpoint with " << checkpoint->size() << " finished trials" << std::endl;
+    }
+    //Sequence number of the first record of the next sweep point
+    uint64_t sequence = 0;
+    //S-boxes only depend on the seed and their width, so every width is generated once
+    std::map<size_t, std::unique_ptr<size_t[]>> sboxes;
+    auto get_sbox = [&](size_t width) {
+        std::unique_ptr<size_t[]>& sbox = sboxes[width];
+        if(!sbox)
+            sbox = make_feistel_sbox(width, options.seed);
+        return sbox.get();
     };
 
-    //The feistel network function
-    auto feistel_function = make_feistel_encrypt<BITS, FEISTEL_ROUNDS>(round_function, keys);
+    for(ExperimentMode mode : options.modes) {
+        if(mode == ExperimentMode::ClassicTest) {
+            std::cout << std::endl << "== classic" << std::endl;
+            run_feistel_classic_test(options.seed);
+            continue;
+        }
+        if(mode == ExperimentMode::SimonTest) {
+            for(Backend backend : options.backends) {
+                std::cout << std::endl << "== simon, backend " << backend_name(backend) << std::endl;
+                test_simon(options.seed, backend);
+            }
+            continue;
+        }
 
-    //Random swap test function, maps any integer to another integer in a one-to-one fashion
-    auto random_function = [=](size_t input) {
-        return random_permutation_map[input];
-    };
+        if(mode == ExperimentMode::Estimate || mode == ExperimentMode::Qasm) {
+            for(size_t bits : options.bits) {
+                size_t sbox_width = feistel_sbox_width(bits, options.sbox_width);
+                const size_t* sbox = get_sbox(sbox_width);
+
+                for(size_t rounds : options.rounds) {
+                    std::cout << std::endl << "== " << mode_name(mode) << ", oracle " << oracle_name(options.oracle) << ", bits " << bits << ", rounds " << rounds
+                        << ", S-box width " << sbox_width
+                        << ", decomposition " << decomposition_name(options.decomposition)
+                        << (options.cache_circuits ? ", optimised circuit" : "") << std::endl;
+                    dispatch_bits<QA_MIN_BITS, QA_MAX_ESTIMATE_BITS>(bits, [&](auto size) {
+                        if(mode == ExperimentMode::Estimate)
+                            run_resource_estimate<decltype(size)::value>(options, sbox, sbox_width, rounds);
+                        else
+                            run_qasm_export<decltype(size)::value>(options, sbox, sbox_width, rounds);
+                    });
+                }
+            }
+            continue;
+        }
+
+        if(mode == ExperimentMode::Precision) {
+            for(size_t bits : options.bits) {
+                size_t sbox_width = feistel_sbox_width(bits, options.sbox_width);
+                const size_t* sbox = get_sbox(sbox_width);
+
+                for(size_t rounds : options.rounds) {
+                    std::cout << std::endl << "== precision, oracle " << oracle_name(options.oracle) << ", bits " << bits << ", rounds " << rounds
+                        << (options.cache_circuits ? ", optimised circuit" : "") << std::endl;
+                    dispatch_bits(bits, [&](auto size) {
+                        run_precision_comparison<decltype(size)::value>(options, sbox, sbox_width, rounds);
+                    });
+                }
+            }
+            continue;
+        }
 
-    //Run feistel detection on a feistel network
-    std::cout << "Running detection for feistel function: " << std::endl;
-    run_feistel_detect<BITS>(feistel_function);
+        if(mode == ExperimentMode::Import) {
+            if(options.import_file.empty())
+                throw std::runtime_error("The import mode needs an OpenQASM file, see --import");
+            std::ifstream in(options.import_file);
+            if(!in)
+                throw std::runtime_error("Could not open OpenQASM file " + options.import_file);
+            Circuit circuit = read_qasm(in);
+            for(Backend backend : options.backends) {
+                if(backend == Backend::Sampler)
+                    throw std::runtime_error("The sampler backend does not run circuits, the import mode needs a simulating backend");
+                for(size_t bits : options.bits) {
+                    size_t sbox_width = feistel_sbox_width(bits, options.sbox_width);
+                    const size_t* sbox = get_sbox(sbox_width);
+
+                    for(size_t rounds : options.rounds) {
+                        std::cout << std::endl << "== import " << options.import_file << ", backend " << backend_name(backend) << ", bits " << bits << ", rounds " << rounds << std::endl;
+                        dispatch_bits(bits, [&](auto size) {
+                            run_imported_detection<decltype(size)::value>(options, circuit, sbox, sbox_width, rounds, backend);
+                        });
+                    }
+                }
+            }
+            continue;
+        }
 
-    //Run feistel detection on a random permutation
-    std::cout << std::endl << "Running detection for random permutation function: " << std::endl;
-    run_feistel_detect<BITS>(random_function);
+        TrialSelection selection = mode == ExperimentMode::Feistel ? TrialSelection::Feistel
+            : mode == ExperimentMode::Random ? TrialSelection::Random : TrialSelection::Both;
+        for(Backend backend : options.backends) {
+            for(size_t bits : options.bits) {
+                size_t sbox_width = feistel_sbox_width(bits, options.sbox_width);
+                const size_t* sbox = get_sbox(sbox_width);
+
+                for(size_t rounds : options.rounds) {
+                    std::cout << std::endl << "== " << mode_name(mode) << ", backend " << backend_name(backend) << ", bits " << bits << ", rounds " << rounds << std::endl;
+                    TrialConfig config = {options.trials, options.seed, backend, rounds, selection, sbox_width, options.oracle, options.decomposition, options.cache_circuits};
+                    dispatch_bits(bits, [&](auto size) {
+                        run_sweep_point<decltype(size)::value>(config, sbox, pool, tables.get(), sink.get(), checkpoint.get(), sequence, options.verbose);
+                    });
+                    sequence += config.count();
+                }
+            }
+        }
+    }
 
-    delete[] random_permutation_map;
-    delete[] feistel_permutation_map;
+    if(sink)
+        sink->close();
 }
 
-int main() {
-    //Initialize libquantum seed
-    std::srand(std::time(nullptr));
+//Runs the experiments selected on the command line, see EXPERIMENT_USAGE in options.hpp
+//Runs are reproducible, and table files are only reused between runs, when a fixed seed is given
+int main(int argc, char** argv) {
+    ExperimentOptions options;
+    try {
+        if(!parse_options(argc, argv, options)) {
+            std::cout << EXPERIMENT_USAGE;
+            return 0;
+        }
+    }
+    catch(const std::invalid_argument& e) {
+        std::cerr << e.what() << std::endl << EXPERIMENT_USAGE;
+        return 1;
+    }
+
+    try {
+        run_experiment(options);
+    }
+    catch(const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
 
-    run_feistel_tests();
-    
     return 0;
-}
\ No newline at end of file
+}